@@ -1,12 +1,20 @@
 #include "audiodevicemanager.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSemaphore>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
 #include <Functiondiscoverykeys_devpkey.h>
+#include <algorithm>
+#include <iterator>
 #include <optional>
 #include <Objbase.h>
 #include "endpointvolume.h"
 
 #include "volumecontroller/hresulterrors.h"
+#include "backendtrace.h"
 
 template<typename T>
 struct ComMemoryRelease {
@@ -65,59 +73,228 @@ HRESULT Foreach(IAudioSessionEnumerator *collection, Functor && f) {
 
 AudioDeviceManager::AudioDeviceManager(AudioDevice &&dev) : _device(std::move(dev)), _manager(_device.manager()) {}
 
-std::optional<AudioDeviceManager> AudioDeviceManager::Default(EDataFlow flow, ERole role)
-{
+static ComPtr<IMMDeviceEnumerator> CreateEnumerator() {
 	ComPtr<IMMDeviceEnumerator> enumerator;
 	GET_INTO_COMPTR(IMMDeviceEnumerator, enumerator, pEnumerator, RET_EMPTY(CoCreateInstance(__uuidof(MMDeviceEnumerator),
 																										  NULL, CLSCTX_INPROC_SERVER,
 																										  __uuidof(IMMDeviceEnumerator),
 																										  (void**)&pEnumerator)));
+	return enumerator;
+}
+
+std::optional<AudioDeviceManager> AudioDeviceManager::Default(EDataFlow flow, ERole role)
+{
+	auto enumerator = CreateEnumerator();
+	if(!enumerator)
+		return {};
 
 	ComPtr<IMMDevice> device;
 	GET_INTO_COMPTR(IMMDevice, device, pDevice, RET_EMPTY(enumerator->GetDefaultAudioEndpoint(flow, role, &pDevice)));
 	return AudioDeviceManager(AudioDevice(std::move(device)));
+}
+
+std::optional<AudioDeviceManager> AudioDeviceManager::FromId(const QString &id)
+{
+	auto enumerator = CreateEnumerator();
+	if(!enumerator)
+		return {};
+
+	ComPtr<IMMDevice> device;
+	GET_INTO_COMPTR(IMMDevice, device, pDevice, RET_EMPTY(enumerator->GetDevice(reinterpret_cast<LPCWSTR>(id.utf16()), &pDevice)));
+	return AudioDeviceManager(AudioDevice(std::move(device)));
+}
+
+std::vector<QString> AudioDeviceManager::ActiveIds()
+{
+	auto enumerator = CreateEnumerator();
+	if(!enumerator)
+		return {};
 
-//	ComPtr<IMMDeviceCollection> devices;
-//	GET_INTO_COMPTR(IMMDeviceCollection, devices, pDevices, RET_FAILED(enumerator->EnumAudioEndpoints(
-//																								 eRender, DEVICE_STATE_ACTIVE,
-//																								 &pDevices)));
+	std::vector<QString> ids;
+	for(const EDataFlow flow : {EDataFlow::eRender, EDataFlow::eCapture}) {
+		IMMDeviceCollection *pDevices;
+		if(FAILED(enumerator->EnumAudioEndpoints(flow, DEVICE_STATE_ACTIVE, &pDevices)))
+			continue;
+		ComPtr<IMMDeviceCollection> devices(pDevices);
+
+		Foreach(devices.get(), [&](const UINT index, ComPtr<IMMDevice> ptr) {
+			AudioDevice device {std::move(ptr)};
+			const auto id = device.id();
+			if(!id)
+				return S_FALSE;
+			qInfo().nospace() << "Endpoint " << index << ": " << device.name().value_or("?") << " (" << *id << ")";
+			ids.push_back(*id);
+			return S_OK;
+		});
+	}
+
+	IMMDevice *pDefault;
+	if(FAILED(enumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &pDefault)))
+		return ids;
+	if(const auto defaultId = AudioDevice(ComPtr<IMMDevice>(pDefault)).id()) {
+		const auto it = std::find(ids.begin(), ids.end(), *defaultId);
+		if(it != ids.end())
+			std::rotate(ids.begin(), it, it + 1);
+	}
+	return ids;
+}
 
-//	RET_FAILED(Foreach(devices.get(), [](const UINT index, ComPtr<IMMDevice> ptr) {
-//		Device device {std::move(ptr)};
-//		const auto opId = device.id();
-//		const auto opName = device.name();
-//		if(!opId.has_value() || ! opName.has_value())
-//			return S_FALSE;
+std::optional<AudioEndpoint> OpenEndpoint(const QString &id) {
+	QElapsedTimer timer;
+	timer.start();
+	auto manager = AudioDeviceManager::FromId(id);
+	if(!manager)
+		return {};
 
+	AudioEndpoint endpoint(std::move(*manager));
+	endpoint.id = id;
+	endpoint.flow = endpoint.manager.device().flow().value_or(EDataFlow::eRender);
+	endpoint.name = endpoint.manager.device().name().value_or(endpoint.flow == EDataFlow::eCapture ? "Mikrofon" : "Lautsprecher");
+	endpoint.control = endpoint.manager.createDeviceControl();
+	if(!endpoint.control)
+		return {};
+	auto sessionGroups = endpoint.manager.createSessionGroups();
+	if(!sessionGroups)
+		return {};
+	endpoint.sessionGroups = std::move(*sessionGroups);
+	endpoint.openUs = timer.nsecsElapsed() / 1000;
+	return endpoint;
+}
 
-//		qInfo().nospace() << "Endpoint " << index << ": " << *opName << " (" << *opId << ")";
-//		return S_OK;
-	//	}));
+std::vector<AudioEndpoint> OpenEndpoints(const std::vector<QString> &ids) {
+	// the endpoints outlive the workers, keep the multithreaded apartment they are created in alive
+	static const bool apartmentHeld = []() {
+		CO_MTA_USAGE_COOKIE cookie;
+		return SUCCEEDED(CoIncrementMTAUsage(&cookie));
+	}();
+	Q_UNUSED(apartmentHeld);
+
+	QElapsedTimer timer;
+	timer.start();
+	std::vector<std::optional<AudioEndpoint>> opened(ids.size());
+	QSemaphore done;
+	for(size_t i = 0; i < ids.size(); ++i) {
+		QThreadPool::globalInstance()->start([&, i]() {
+			const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+			opened[i] = OpenEndpoint(ids[i]);
+			if(comInitialized)
+				CoUninitialize();
+			done.release();
+		});
+	}
+	done.acquire(int(ids.size()));
+
+	std::vector<AudioEndpoint> endpoints;
+	qint64 slowestUs = 0;
+	qint64 totalUs = 0;
+	for(size_t i = 0; i < opened.size(); ++i) {
+		if(!opened[i]) {
+			qWarning() << "Could not open endpoint" << ids[i];
+			continue;
+		}
+		slowestUs = std::max(slowestUs, opened[i]->openUs);
+		totalUs += opened[i]->openUs;
+		endpoints.push_back(std::move(*opened[i]));
+	}
+	qDebug().nospace() << "Opened " << endpoints.size() << " endpoints in " << timer.nsecsElapsed() / 1000 << " us, slowest "
+							 << slowestUs << " us, " << totalUs << " us one after another";
+	return endpoints;
+}
+
+void OpenActiveEndpointsInBackground(std::vector<QString> known, QObject *context,
+												 std::function<void(std::vector<QString> &&, std::vector<AudioEndpoint> &&)> done) {
+	// not a pool thread, OpenEndpoints waits for the pool
+	QThread *thread = QThread::create([known = std::move(known), receiver = QPointer<QObject>(context), done = std::move(done)]() {
+		const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+		// both kept copyable for the queued call
+		auto ids = std::make_shared<std::vector<QString>>(AudioDeviceManager::ActiveIds());
+		auto endpoints = std::make_shared<std::vector<AudioEndpoint>>();
+		std::vector<QString> missing;
+		std::copy_if(ids->begin(), ids->end(), std::back_inserter(missing), [&](const QString &id) {
+			return std::find(known.begin(), known.end(), id) == known.end();
+		});
+		if(!missing.empty())
+			*endpoints = OpenEndpoints(missing);
+		if(comInitialized)
+			CoUninitialize();
+		if(receiver) {
+			QMetaObject::invokeMethod(receiver.data(), [ids, endpoints, done]() {
+				done(std::move(*ids), std::move(*endpoints));
+			}, Qt::QueuedConnection);
+		}
+	});
+	thread->setObjectName("EndpointOpener");
+	QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+	thread->start();
+}
+
+ComPtr<EndpointNotification> EndpointNotification::Register() {
+	auto enumerator = CreateEnumerator();
+	if(!enumerator)
+		return {};
+	IMMDeviceEnumerator &registrar = *enumerator;
+	ComPtr<EndpointNotification> notification(new EndpointNotification(std::move(enumerator)));
+	RET_EMPTY(BACKEND_CALL(RegisterNotification, "endpoints", registrar.RegisterEndpointNotificationCallback(notification.get())));
+	return notification;
+}
+
+void EndpointNotification::unregister() {
+	if(enumerator)
+		BACKEND_CALL(UnregisterNotification, "endpoints", enumerator->UnregisterEndpointNotificationCallback(this));
+	enumerator.reset();
+}
+
+HRESULT EndpointNotification::OnDeviceStateChanged(LPCWSTR deviceId, DWORD newState) {
+	qDebug() << "Endpoint" << QString::fromWCharArray(deviceId) << "changed state to" << newState;
+	emit endpointsChanged();
+	return S_OK;
+}
+
+HRESULT EndpointNotification::OnDeviceAdded(LPCWSTR deviceId) {
+	qDebug() << "Endpoint" << QString::fromWCharArray(deviceId) << "added";
+	emit endpointsChanged();
+	return S_OK;
+}
+
+HRESULT EndpointNotification::OnDeviceRemoved(LPCWSTR deviceId) {
+	qDebug() << "Endpoint" << QString::fromWCharArray(deviceId) << "removed";
+	emit endpointsChanged();
+	return S_OK;
+}
+
+HRESULT EndpointNotification::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR defaultDeviceId) {
+	// the sections are ordered by the default multimedia render endpoint only
+	if(flow != EDataFlow::eRender || role != ERole::eMultimedia)
+		return S_OK;
+	qDebug() << "Default endpoint changed to" << (defaultDeviceId ? QString::fromWCharArray(defaultDeviceId) : QString());
+	emit endpointsChanged();
+	return S_OK;
+}
+
+HRESULT EndpointNotification::OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) {
+	return S_OK;
 }
 
 std::unique_ptr<AudioSession> CreateSession(IAudioSessionControl * ptr) {
 	ComPtr<IAudioSessionControl2> control;
-	GET_INTO_COMPTR(IAudioSessionControl2, control, pControl, RET_EMPTY(ptr->QueryInterface(&pControl)));
+	GET_INTO_COMPTR(IAudioSessionControl2, control, pControl, RET_EMPTY(BACKEND_CALL(QueryInterface, "create session", ptr->QueryInterface(&pControl))));
 
 	ComPtr<ISimpleAudioVolume> volume;
-	GET_INTO_COMPTR(ISimpleAudioVolume, volume, pVolume, RET_EMPTY(ptr->QueryInterface(&pVolume)));
+	GET_INTO_COMPTR(ISimpleAudioVolume, volume, pVolume, RET_EMPTY(BACKEND_CALL(QueryInterface, "create session", ptr->QueryInterface(&pVolume))));
 
 	ComPtr<IAudioMeterInformation> meter;
-	GET_INTO_COMPTR(IAudioMeterInformation, meter, pMeter, RET_EMPTY(ptr->QueryInterface(&pMeter)));
+	GET_INTO_COMPTR(IAudioMeterInformation, meter, pMeter, RET_EMPTY(BACKEND_CALL(QueryInterface, "create session", ptr->QueryInterface(&pMeter))));
 
 	return std::make_unique<AudioSession>(std::move(control), std::move(volume), std::move(meter));
 }
 
 bool InsertIntoGroup(std::unique_ptr<AudioSession> &&session, AudioSessionGroups &groups) {
-	DWORD pid;
-	if(FAILED(session->control().GetProcessId(&pid)))
-		return false;
-
-	GUID guid;
-	if(FAILED(session->control().GetGroupingParam(&guid)))
+	const auto pid = session->pid();
+	const auto guid = session->groupingParam();
+	if(!pid || !guid)
 		return false;
 
-	groups.insert(std::move(session), pid, guid);
+	groups.insert(std::move(session), *pid, *guid);
 	return true;
 }
 
@@ -165,6 +342,14 @@ std::optional<QString> AudioDevice::name() {
 	return QString::fromWCharArray(nameProp.pwszVal);
 }
 
+std::optional<EDataFlow> AudioDevice::flow() {
+	ComPtr<IMMEndpoint> endpoint;
+	GET_INTO_COMPTR(IMMEndpoint, endpoint, pEndpoint, RET_EMPTY(device->QueryInterface(&pEndpoint)));
+	EDataFlow value;
+	RET_EMPTY(endpoint->GetDataFlow(&value));
+	return value;
+}
+
 ComPtr<IAudioSessionManager2> AudioDevice::manager() {
 	return Activate<IAudioSessionManager2>(device.get());
 }
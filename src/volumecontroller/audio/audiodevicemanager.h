@@ -3,7 +3,9 @@
 #include "volumecontroller/audio/audiosessions.h"
 #include "volumecontroller/hresulterrors.h"
 
+#include <functional>
 #include <optional>
+#include <vector>
 
 template<typename T, typename From>
 ComPtr<T> Activate(From *from) {
@@ -24,6 +26,7 @@ public:
 
 	std::optional<QString> id();
 	std::optional<QString> name();
+	std::optional<EDataFlow> flow();
 
 	ComPtr<IAudioSessionManager2> manager();
 	ComPtr<IAudioEndpointVolume> volume();
@@ -44,6 +47,10 @@ public:
 	AudioDeviceManager(AudioDevice && device);
 
 	static std::optional<AudioDeviceManager> Default(EDataFlow flow = EDataFlow::eRender, ERole role = ERole::eMultimedia);
+	static std::optional<AudioDeviceManager> FromId(const QString &id);
+
+	// Ids of all active render and capture endpoints, the default render endpoint first
+	static std::vector<QString> ActiveIds();
 
 	std::optional<AudioSessionGroups> createSessionGroups();
 
@@ -54,4 +61,53 @@ public:
 	IAudioSessionManager2 &manager() { return *_manager; }
 };
 
+// Backend objects of one endpoint, opened before its section is created
+struct AudioEndpoint {
+	AudioEndpoint(AudioDeviceManager &&manager) : manager(std::move(manager)) {}
+
+	AudioDeviceManager manager;
+	std::unique_ptr<DeviceAudioControl> control;
+	AudioSessionGroups sessionGroups;
+	QString id;
+	QString name;
+	EDataFlow flow = EDataFlow::eRender;
+	qint64 openUs = 0;
+};
+
+// Opens the device control and the sessions of an endpoint, safe on any thread with COM initialized
+std::optional<AudioEndpoint> OpenEndpoint(const QString &id);
+
+// Opens every endpoint on its own thread pool worker, so this takes about as long as the slowest one.
+// The order of ids is kept, endpoints failing to open are left out.
+std::vector<AudioEndpoint> OpenEndpoints(const std::vector<QString> &ids);
+
+// Enumerates the active endpoints and opens the ones not in known without blocking. done gets the ActiveIds() and the
+// opened endpoints, it runs on the thread of context unless it is destroyed before.
+void OpenActiveEndpointsInBackground(std::vector<QString> known, QObject *context,
+												 std::function<void(std::vector<QString> &&, std::vector<AudioEndpoint> &&)> done);
+
+// Reports endpoints appearing, disappearing or becoming the default render endpoint. Signals are emitted on
+// backend threads, registered until unregister() is called.
+class EndpointNotification final : public QObject, public IUnknownBase<EndpointNotification, IMMNotificationClient> {
+	Q_OBJECT
+
+public:
+	static ComPtr<EndpointNotification> Register();
+	void unregister();
+
+	HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR deviceId, DWORD newState) override;
+	HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR deviceId) override;
+	HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR deviceId) override;
+	HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR defaultDeviceId) override;
+	HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR deviceId, const PROPERTYKEY key) override;
+
+signals:
+	void endpointsChanged();
+
+private:
+	EndpointNotification(ComPtr<IMMDeviceEnumerator> &&enumerator) : enumerator(std::move(enumerator)) {}
+
+	ComPtr<IMMDeviceEnumerator> enumerator;
+};
+
 #endif // AUDIODEVICEMANAGER_H
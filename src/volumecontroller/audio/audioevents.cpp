@@ -0,0 +1,100 @@
+#include "audioevents.h"
+#include "volumecontroller/metrics.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+AudioEvent AudioEvent::volumeChanged(AudioEventSource &source, float volume, bool muted) {
+	AudioEvent event{&source, Type::Volume};
+	event.volume = volume;
+	event.muted = muted;
+	return event;
+}
+
+AudioEvent AudioEvent::stateChanged(AudioEventSource &source, int state) {
+	AudioEvent event{&source, Type::State};
+	event.state = state;
+	return event;
+}
+
+AudioEvent AudioEvent::groupingParamChanged(AudioEventSource &source, const GUID *groupingParam) {
+	AudioEvent event{&source, Type::GroupingParam};
+	event.hasGroupingParam = groupingParam != nullptr;
+	if(groupingParam)
+		event.groupingParam = *groupingParam;
+	return event;
+}
+
+AudioEventSource::~AudioEventSource() {
+	AudioEventQueue::instance().forget(*this);
+}
+
+AudioEventQueue &AudioEventQueue::instance() {
+	static AudioEventQueue queue;
+	return queue;
+}
+
+void AudioEventQueue::post(const AudioEvent &event) {
+	{
+		QMutexLocker lock(&mutex);
+		if(event.type == AudioEvent::Type::Volume) {
+			const auto it = std::find_if(pending.rbegin(), pending.rend(), [&](const AudioEvent &other) {
+				return other.source == event.source && other.type == AudioEvent::Type::Volume;
+			});
+			if(it != pending.rend()) {
+				static Counter &coalesced = Metrics::instance().counter("volumecontroller_events_coalesced_total", "", "type=\"model\"");
+				coalesced.add();
+				*it = event;
+				return;
+			}
+		}
+		pending.push_back(event);
+		if(scheduled)
+			return;
+		scheduled = true;
+	}
+	QMetaObject::invokeMethod(QCoreApplication::instance(), [this]() {
+		deliver();
+	}, Qt::QueuedConnection);
+}
+
+void AudioEventQueue::forget(AudioEventSource &source) {
+	const auto clear = [&](std::vector<AudioEvent> &events) {
+		for(AudioEvent &event : events) {
+			if(event.source == &source)
+				event.source = nullptr;
+		}
+	};
+	QMutexLocker lock(&mutex);
+	clear(pending);
+	clear(delivering);
+}
+
+void AudioEventQueue::deliver() {
+	static LatencyHistogram &deliveryTime = Metrics::instance().histogram("volumecontroller_model_delivery_seconds",
+																								 "Duration of handing a batch of backend events to their observers");
+	static Counter &delivered = Metrics::instance().counter("volumecontroller_model_events_total", "Backend events delivered to observers");
+	ScopedLatency latency(deliveryTime);
+	{
+		QMutexLocker lock(&mutex);
+		delivering.swap(pending);
+		scheduled = false;
+	}
+	// observers may destroy sources, forget clears their events from the batch
+	size_t count = 0;
+	for(;; ++count) {
+		AudioEvent event;
+		{
+			QMutexLocker lock(&mutex);
+			if(count == delivering.size()) {
+				delivering.clear();
+				break;
+			}
+			event = delivering[count];
+		}
+		if(event.source)
+			event.source->deliver(event);
+	}
+	delivered.add(count);
+}
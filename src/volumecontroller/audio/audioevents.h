@@ -0,0 +1,83 @@
+#ifndef AUDIOEVENTS_H
+#define AUDIOEVENTS_H
+
+#include <QtGlobal>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <QUuid>
+// same layout, lets the benchmarks build on other platforms
+using GUID = QUuid;
+#endif
+
+#include <QMutex>
+
+#include <vector>
+
+class AudioEventSource;
+
+// Change reported by a backend callback, plain data so queueing it does not allocate
+struct AudioEvent {
+	enum class Type {
+		Volume,
+		State,
+		GroupingParam
+	};
+
+	static AudioEvent volumeChanged(AudioEventSource &source, float volume, bool muted);
+	static AudioEvent stateChanged(AudioEventSource &source, int state);
+	static AudioEvent groupingParamChanged(AudioEventSource &source, const GUID *groupingParam);
+
+	AudioEventSource *source = nullptr;
+	Type type = Type::Volume;
+	float volume = 0.0f;
+	bool muted = false;
+	int state = 0;
+	bool hasGroupingParam = false;
+	GUID groupingParam{};
+};
+
+// Model object reporting backend events to observers on the GUI thread
+class AudioEventSource {
+public:
+	Q_DISABLE_COPY_MOVE(AudioEventSource);
+
+protected:
+	AudioEventSource() = default;
+	// Drops the events still queued for this source. Must not race with the delivery of its own events,
+	// so sources handed to the GUI thread are destroyed there.
+	~AudioEventSource();
+
+	// Called on the GUI thread for every event posted for this source
+	virtual void deliver(const AudioEvent &event) = 0;
+
+private:
+	friend class AudioEventQueue;
+};
+
+// The one place where backend callbacks cross over to the GUI thread. Events are collected and delivered
+// in one queued call per batch, a volume event replaces the one of its source still waiting.
+class AudioEventQueue {
+public:
+	static AudioEventQueue &instance();
+
+	// Safe to call from any thread
+	void post(const AudioEvent &event);
+
+	void forget(AudioEventSource &source);
+
+private:
+	AudioEventQueue() = default;
+
+	void deliver();
+
+	QMutex mutex;
+	std::vector<AudioEvent> pending;
+	bool scheduled = false;
+
+	// batch being delivered on the GUI thread, the capacity of both buffers is reused
+	std::vector<AudioEvent> delivering;
+};
+
+#endif // AUDIOEVENTS_H
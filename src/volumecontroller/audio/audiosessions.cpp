@@ -1,8 +1,12 @@
 #include "volumecontroller/audio/audiosessions.h"
 #include "volumecontroller/hresulterrors.h"
 #include "audiodevicemanager.h"
+#include "volumeprofiles.h"
+#include "backendtrace.h"
+#include "volumecontroller/metrics.h"
 
 #include <algorithm>
+#include <QCoreApplication>
 #include <QDebug>
 
 GUID CreateGuid() {
@@ -11,77 +15,176 @@ GUID CreateGuid() {
 	return guid;
 }
 
+namespace {
+
+class SessionControlState final : public AudioControlState {
+public:
+	SessionControlState(ComPtr<ISimpleAudioVolume> &&control, ComPtr<IAudioMeterInformation> &&meter, const GUID &eventContext)
+		: control(std::move(control)), meter(std::move(meter)), eventContext(eventContext) {}
+
+	bool readPeak(float &value) override {
+		return SUCCEEDED(BACKEND_CALL(GetPeakValue, "peak poll", meter->GetPeakValue(&value)));
+	}
+
+	bool writeVolume(float value) override {
+		return SUCCEEDED(BACKEND_CALL(SetMasterVolume, "session write", control->SetMasterVolume(value, &eventContext)));
+	}
+
+	bool writeMuted(bool value) override {
+		return SUCCEEDED(BACKEND_CALL(SetMute, "session write", control->SetMute(value, &eventContext)));
+	}
+
+	const ComPtr<ISimpleAudioVolume> control;
+	const ComPtr<IAudioMeterInformation> meter;
+	const GUID eventContext;
+};
+
+class DeviceControlState final : public AudioControlState {
+public:
+	DeviceControlState(ComPtr<IAudioEndpointVolume> &&control, ComPtr<IAudioMeterInformation> &&meter, const GUID &eventContext)
+		: control(std::move(control)), meter(std::move(meter)), eventContext(eventContext) {}
+
+	bool readPeak(float &value) override {
+		return SUCCEEDED(BACKEND_CALL(GetPeakValue, "peak poll", meter->GetPeakValue(&value)));
+	}
+
+	bool writeVolume(float value) override {
+		return SUCCEEDED(BACKEND_CALL(SetMasterVolume, "device write", control->SetMasterVolumeLevelScalar(value, &eventContext)));
+	}
+
+	bool writeMuted(bool value) override {
+		return SUCCEEDED(BACKEND_CALL(SetMute, "device write", control->SetMute(value, &eventContext)));
+	}
+
+	const ComPtr<IAudioEndpointVolume> control;
+	const ComPtr<IAudioMeterInformation> meter;
+	const GUID eventContext;
+};
+
+}
+
 AudioSession::AudioSession(ComPtr<IAudioSessionControl2> &&ctrl, ComPtr<ISimpleAudioVolume> &&vol, ComPtr<IAudioMeterInformation> &&audioMeterInfo)
 	: _eventContext(CreateGuid()),
 	  _sessionControl(std::move(ctrl)),
-	  volumeControl(std::move(vol))
-	, audioMeterInfo(std::move(audioMeterInfo)), sessionEvents(new AudioSessionEvents(*this))
+	  controlState(std::make_shared<SessionControlState>(std::move(vol), std::move(audioMeterInfo), _eventContext))
+	, sessionEvents(new AudioSessionEvents(*this))
+	, memory(MemoryCategory::Sessions, sizeof(AudioSession) + sizeof(SessionControlState) + sizeof(AudioSessionEvents))
 {
-	_sessionControl->RegisterAudioSessionNotification(sessionEvents.get());
+	BACKEND_CALL(RegisterNotification, "session created", _sessionControl->RegisterAudioSessionNotification(sessionEvents.get()));
+
+	auto &volumeControl = static_cast<SessionControlState &>(*controlState).control;
+	float volume;
+	if(SUCCEEDED(BACKEND_CALL(GetMasterVolume, "session created", volumeControl->GetMasterVolume(&volume))))
+		controlState->volume = volume;
+	BOOL muted;
+	if(SUCCEEDED(BACKEND_CALL(GetMute, "session created", volumeControl->GetMute(&muted))))
+		controlState->muted = muted == TRUE;
+
+	DWORD pid;
+	if(SUCCEEDED(BACKEND_CALL(GetProcessId, "session created", _sessionControl->GetProcessId(&pid))))
+		_pid = pid;
+	_isSystemSound = BACKEND_CALL(IsSystemSoundsSession, "session created", _sessionControl->IsSystemSoundsSession()) == S_OK;
+	AudioSessionState state;
+	if(SUCCEEDED(BACKEND_CALL(GetState, "session created", _sessionControl->GetState(&state))))
+		_state = state;
+	GUID groupingParam;
+	if(SUCCEEDED(BACKEND_CALL(GetGroupingParam, "session created", _sessionControl->GetGroupingParam(&groupingParam))))
+		_groupingParam = groupingParam;
+
+	AudioThread::instance().addMeter(controlState);
 }
 
 AudioSession::~AudioSession()
 {
-	_sessionControl->UnregisterAudioSessionNotification(sessionEvents.get());
+	AudioThread::instance().removeMeter(controlState.get());
+	// unregistering waits for running callbacks, detached they no longer reach this session
+	sessionEvents->detach();
+	AudioThread::instance().post([control = std::shared_ptr<IAudioSessionControl2>(std::move(_sessionControl)),
+										  events = std::shared_ptr<AudioSessionEvents>(std::move(sessionEvents))]() {
+		BACKEND_CALL(UnregisterNotification, "session destroyed", control->UnregisterAudioSessionNotification(events.get()));
+	});
 }
 
 std::optional<float> AudioSession::volume() const {
-	float vol;
-	RET_EMPTY(volumeControl->GetMasterVolume(&vol));
-	return vol;
+	return controlState->volume.load();
 }
 
 bool AudioSession::setVolume(float v) {
-	return SUCCEEDED(volumeControl->SetMasterVolume(v, &eventContext()));
+	AudioThread::instance().setVolume(controlState, v);
+	return true;
 }
 
 std::optional<bool> AudioSession::muted() const {
-	BOOL muted;
-	RET_EMPTY(volumeControl->GetMute(&muted));
-	return muted == TRUE;
+	return controlState->muted.load();
 }
 
 bool AudioSession::setMuted(bool muted) {
-	return SUCCEEDED(volumeControl->SetMute(muted, &eventContext()));
+	AudioThread::instance().setMuted(controlState, muted);
+	return true;
 }
 
 std::optional<AudioSession::State> AudioSession::state() const {
-	AudioSessionState state;
-	RET_EMPTY(_sessionControl->GetState(&state));
-	return static_cast<AudioSession::State>(state);
+	return static_cast<AudioSession::State>(_state.load());
 }
 
 bool AudioSession::isSystemSound() const {
-	return _sessionControl->IsSystemSoundsSession() == S_OK;
+	return _isSystemSound;
 }
 
 std::optional<DWORD> AudioSession::pid() const
 {
-	DWORD pid;
-	RET_EMPTY(_sessionControl->GetProcessId(&pid));
-	return pid;
+	return _pid;
+}
+
+std::optional<GUID> AudioSession::groupingParam() const
+{
+	QMutexLocker locker(&groupingParamMutex);
+	return _groupingParam;
 }
 
 void AudioSession::onVolumeChangedEvent(float newVolume, bool newMute)
 {
-	emit volumeChanged(newVolume, newMute);
+	controlState->volume = newVolume;
+	controlState->muted = newMute;
+	AudioEventQueue::instance().post(AudioEvent::volumeChanged(*this, newVolume, newMute));
 }
 
 void AudioSession::onStateChangedEvent(AudioSessionState newState)
 {
-	emit stateChanged(newState);
+	_state = newState;
+	AudioEventQueue::instance().post(AudioEvent::stateChanged(*this, newState));
 }
 
 void AudioSession::onGroupingParamChangedEvent(const GUID *newGroupingParam)
 {
-	emit groupingParamChanged(newGroupingParam);
+	if(newGroupingParam) {
+		QMutexLocker locker(&groupingParamMutex);
+		_groupingParam = *newGroupingParam;
+	}
+	AudioEventQueue::instance().post(AudioEvent::groupingParamChanged(*this, newGroupingParam));
+}
+
+void AudioSession::deliver(const AudioEvent &event) {
+	switch(event.type) {
+	case AudioEvent::Type::Volume:
+		_volumeObservers.notify(event.volume, event.muted);
+		break;
+	case AudioEvent::Type::State:
+		_stateObservers.notify(event.state);
+		break;
+	case AudioEvent::Type::GroupingParam:
+		_groupingParamObservers.notify(event.hasGroupingParam ? &event.groupingParam : nullptr);
+		break;
+	}
 }
 
 std::optional<float> AudioSession::peakValue() const
 {
-	float value;
-	RET_EMPTY(audioMeterInfo->GetPeakValue(&value));
-	return std ::min(value, 1.0f);
+	return std::min(controlState->peak.load(), 1.0f);
+}
+
+void AudioSession::setPeakAggregate(std::shared_ptr<PeakAggregate> aggregate) {
+	AudioThread::instance().setPeakAggregate(controlState, std::move(aggregate));
 }
 
 void AudioSessionGroup::insert(std::unique_ptr<AudioSession> &&session) {
@@ -152,72 +255,124 @@ void AudioSessionGroups::insert(std::unique_ptr<AudioSession> &&session, DWORD p
 
 DeviceAudioControl::DeviceAudioControl(ComPtr<IAudioEndpointVolume> &&vol, ComPtr<IAudioMeterInformation> &&audioMeterInfo)
 	: _eventContext(CreateGuid()),
-	  volumeControl(std::move(vol)),
-	  audioMeterInfo(std::move(audioMeterInfo)),
+	  controlState(std::make_shared<DeviceControlState>(std::move(vol), std::move(audioMeterInfo), _eventContext)),
+	  volumeControl(static_cast<DeviceControlState &>(*controlState).control.get()),
 	  volumeEvents(new DeviceAudioEvents(*this)) {
-	volumeControl->RegisterControlChangeNotify(volumeEvents.get());
+	BACKEND_CALL(RegisterNotification, "device created", volumeControl->RegisterControlChangeNotify(volumeEvents.get()));
+
+	float volume;
+	if(SUCCEEDED(BACKEND_CALL(GetMasterVolume, "device created", volumeControl->GetMasterVolumeLevelScalar(&volume))))
+		controlState->volume = volume;
+	BOOL muted;
+	if(SUCCEEDED(BACKEND_CALL(GetMute, "device created", volumeControl->GetMute(&muted))))
+		controlState->muted = muted == TRUE;
+
+	AudioThread::instance().addMeter(controlState);
 }
 
 DeviceAudioControl::~DeviceAudioControl() {
-	volumeControl->UnregisterControlChangeNotify(volumeEvents.get());
+	AudioThread::instance().removeMeter(controlState.get());
+	volumeEvents->detach();
+	// the state keeps the endpoint volume alive until it is unregistered
+	AudioThread::instance().post([state = controlState, events = std::shared_ptr<DeviceAudioEvents>(std::move(volumeEvents))]() {
+		auto &control = static_cast<DeviceControlState &>(*state).control;
+		BACKEND_CALL(UnregisterNotification, "device destroyed", control->UnregisterControlChangeNotify(events.get()));
+	});
 }
 
 std::optional<float> DeviceAudioControl::volume() const
 {
-	float vol;
-	RET_EMPTY(volumeControl->GetMasterVolumeLevelScalar(&vol));
-	return vol;
+	return controlState->volume.load();
 }
 
 bool DeviceAudioControl::setVolume(float v)
 {
-	return SUCCEEDED(volumeControl->SetMasterVolumeLevelScalar(v, &eventContext()));
+	AudioThread::instance().setVolume(controlState, v);
+	return true;
 }
 
 std::optional<bool> DeviceAudioControl::muted() const
 {
-	BOOL muted;
-	RET_EMPTY(volumeControl->GetMute(&muted));
-	return muted;
+	return controlState->muted.load();
 }
 
 bool DeviceAudioControl::setMuted(bool muted)
 {
-	return SUCCEEDED(volumeControl->SetMute(muted, &eventContext()));
+	AudioThread::instance().setMuted(controlState, muted);
+	return true;
 }
 
 std::optional<float> DeviceAudioControl::peakValue() const
 {
-	float peak;
-	RET_EMPTY(audioMeterInfo->GetPeakValue(&peak));
-	return peak;
+	return controlState->peak.load();
 }
 
 void DeviceAudioControl::onVolumeChangedEvent(float volume, bool muted) {
-	emit volumeChanged(volume, muted);
+	controlState->volume = volume;
+	controlState->muted = muted;
+	AudioEventQueue::instance().post(AudioEvent::volumeChanged(*this, volume, muted));
 }
 
-AudioSessionNotification::AudioSessionNotification(QObject *parent) : QObject(parent) {}
+void DeviceAudioControl::deliver(const AudioEvent &event) {
+	if(event.type == AudioEvent::Type::Volume)
+		_volumeObservers.notify(event.volume, event.muted);
+}
+
+AudioSessionNotification::AudioSessionNotification(QObject *parent, const VolumeProfiles *profiles) : QObject(parent), profiles(profiles) {}
 
 HRESULT AudioSessionNotification::OnSessionCreated(IAudioSessionControl *NewSession) {
 	auto session = CreateSession(NewSession);
+	if(!session)
+		return S_OK;
 	qDebug() << "Session created: pid" << session->pid().value_or(0)
 				<< "state" << ToString(session->state().value_or(AudioSession::State::Expired));
+	QMutexLocker locker(&mutex);
+	if(detached) {
+		// its section is gone, still destroyed on the GUI thread like every session
+		QMetaObject::invokeMethod(QCoreApplication::instance(), [orphan = session.release()]() {
+			delete orphan;
+		}, Qt::QueuedConnection);
+		return S_OK;
+	}
+	// applied on the notification thread before the session is handed to the ui to catch the first buffers
+	if(profiles)
+		profiles->apply(*session);
 	emit sessionCreated(session.release());
 	return S_OK;
 }
 
+void AudioSessionNotification::detach() {
+	QMutexLocker locker(&mutex);
+	profiles = nullptr;
+	detached = true;
+}
+
+static Counter &SessionEvents(const char *labels) {
+	return Metrics::instance().counter("volumecontroller_session_events_total", "Audio session events received from the backend", labels);
+}
+
+AudioSessionEvents::AudioSessionEvents(AudioSession &session) : session(&session), eventContext(session.eventContext()) {}
+
+void AudioSessionEvents::detach() {
+	QMutexLocker locker(&mutex);
+	session = nullptr;
+}
+
 bool AudioSessionEvents::isApplicationEvent(LPCGUID context) {
-	return context != nullptr && *context == session.eventContext();
+	return context != nullptr && *context == eventContext;
 }
 
 HRESULT AudioSessionEvents::OnDisplayNameChanged(LPCWSTR NewDisplayName, LPCGUID EventContext) {
+	static Counter &events = SessionEvents("type=\"display_name\"");
+	events.add();
 	if(isApplicationEvent(EventContext))
 		return S_OK;
 	return S_OK;
 }
 
 HRESULT AudioSessionEvents::OnIconPathChanged(LPCWSTR NewIconPath, LPCGUID EventContext) {
+	static Counter &events = SessionEvents("type=\"icon_path\"");
+	events.add();
 	if(isApplicationEvent(EventContext))
 		return S_OK;
 
@@ -225,25 +380,37 @@ HRESULT AudioSessionEvents::OnIconPathChanged(LPCWSTR NewIconPath, LPCGUID Event
 }
 
 HRESULT AudioSessionEvents::OnSimpleVolumeChanged(float NewVolume, BOOL NewMute, LPCGUID EventContext) {
+	static Counter &events = SessionEvents("type=\"volume\"");
+	events.add();
 	if(isApplicationEvent(EventContext))
 		return S_OK;
 
-	session.onVolumeChangedEvent(NewVolume, NewMute);
+	QMutexLocker locker(&mutex);
+	if(session)
+		session->onVolumeChangedEvent(NewVolume, NewMute);
 	return S_OK;
 }
 
 HRESULT AudioSessionEvents::OnChannelVolumeChanged(DWORD ChannelCount, float NewChannelVolumeArray[], DWORD ChangedChannel, LPCGUID EventContext) {
+	static Counter &events = SessionEvents("type=\"channel_volume\"");
+	events.add();
 	return S_OK;
 }
 
 HRESULT AudioSessionEvents::OnGroupingParamChanged(LPCGUID NewGroupingParam, LPCGUID EventContext) {
+	static Counter &events = SessionEvents("type=\"grouping_param\"");
+	events.add();
 	if(isApplicationEvent(EventContext))
 		return S_OK;
-	session.onGroupingParamChangedEvent(NewGroupingParam);
+	QMutexLocker locker(&mutex);
+	if(session)
+		session->onGroupingParamChangedEvent(NewGroupingParam);
 	return S_OK;
 }
 
 HRESULT AudioSessionEvents::OnStateChanged(AudioSessionState NewState) {
+	static Counter &events = SessionEvents("type=\"state\"");
+	events.add();
 	switch (NewState) {
 	case AudioSessionStateActive:
 		break;
@@ -253,11 +420,15 @@ HRESULT AudioSessionEvents::OnStateChanged(AudioSessionState NewState) {
 		break;
 	}
 
-	session.onStateChangedEvent(NewState);
+	QMutexLocker locker(&mutex);
+	if(session)
+		session->onStateChangedEvent(NewState);
 	return S_OK;
 }
 
 HRESULT AudioSessionEvents::OnSessionDisconnected(AudioSessionDisconnectReason DisconnectReason) {
+	static Counter &events = SessionEvents("type=\"disconnected\"");
+	events.add();
 	auto pszReason = "?????";
 
 	switch (DisconnectReason) {
@@ -285,8 +456,16 @@ HRESULT AudioSessionEvents::OnSessionDisconnected(AudioSessionDisconnectReason D
 	return S_OK;
 }
 
+void DeviceAudioEvents::detach() {
+	QMutexLocker locker(&mutex);
+	control = nullptr;
+}
+
 HRESULT DeviceAudioEvents::OnNotify(AUDIO_VOLUME_NOTIFICATION_DATA *pNotify) {
-	if(pNotify->guidEventContext != session.eventContext())
-		session.onVolumeChangedEvent(pNotify->fMasterVolume, pNotify->bMuted);
+	if(pNotify->guidEventContext == eventContext)
+		return S_OK;
+	QMutexLocker locker(&mutex);
+	if(control)
+		control->onVolumeChangedEvent(pNotify->fMasterVolume, pNotify->bMuted);
 	return S_OK;
 }
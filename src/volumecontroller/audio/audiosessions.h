@@ -1,18 +1,24 @@
 #ifndef AUDIOSESSIONS_H
 #define AUDIOSESSIONS_H
 #include "volumecontroller/comptr.h"
+#include "volumecontroller/observerlist.h"
+#include "volumecontroller/audio/audioevents.h"
+#include "volumecontroller/audio/audiothread.h"
 #include "volumecontroller/info/programminformation.h"
+#include "volumecontroller/memoryaccounting.h"
 
 #define NOMINMAX
 #include <mmdeviceapi.h>
 #include <vector>
 #include <optional>
+#include <QMutex>
 #include <QObject>
 #include <audiopolicy.h>
 #include <endpointvolume.h>
 #include <optional>
 
 class AudioSession;
+class VolumeProfiles;
 
 template<typename Derived, typename Base>
 class IUnknownBase : public Base {
@@ -58,12 +64,18 @@ public:
 };
 
 class AudioSessionEvents final : public IUnknownBase<AudioSessionEvents, IAudioSessionEvents> {
-	AudioSession &session;
+	// nullptr once detached
+	AudioSession *session;
+	const GUID eventContext;
+	QMutex mutex;
 
 	bool isApplicationEvent(LPCGUID context);
 
 public:
-	AudioSessionEvents(AudioSession &session) : session(session) {}
+	AudioSessionEvents(AudioSession &session);
+
+	// Stops forwarding to the session, returns once a callback forwarding right now is done
+	void detach();
 
 	// Notification methods for audio session events
 
@@ -93,14 +105,24 @@ class AudioSessionNotification final : public QObject, public IUnknownBase<Audio
 	Q_OBJECT
 
 public:
-	AudioSessionNotification(QObject *parent);
+	AudioSessionNotification(QObject *parent, const VolumeProfiles *profiles = nullptr);
 
 	HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl *NewSession) override;
 
+	// Stops handing out sessions and reading the profiles, returns once a callback doing so right now is done
+	void detach();
+
 signals:
 	void sessionCreated(AudioSession *NewSession);
+
+private:
+	QMutex mutex;
+	// nullptr once detached
+	const VolumeProfiles *profiles;
+	bool detached = false;
 };
 
+// Getters return values cached from the backend events, setters queue the backend call on the AudioThread
 class IAudioControl {
 protected:
 	IAudioControl() = default;
@@ -117,10 +139,11 @@ public:
 	virtual std::optional<float> peakValue() const = 0;
 };
 
-class DeviceAudioControl final : public QObject, public IAudioControl {
-	Q_OBJECT
-
+// Observers are notified on the GUI thread
+class DeviceAudioControl final : public IAudioControl, public AudioEventSource {
 public:
+	using VolumeObservers = ObserverList<float, bool>;
+
 	friend class DeviceAudioEvents;
 
 	DeviceAudioControl(ComPtr<IAudioEndpointVolume> &&vol, ComPtr<IAudioMeterInformation> &&audioMeterInfo);
@@ -137,38 +160,46 @@ public:
 
 	const GUID &eventContext() const { return _eventContext; }
 
-private:
-	void onVolumeChangedEvent(float volume, bool muted);
+	VolumeObservers &volumeObservers() { return _volumeObservers; }
 
-signals:
-	void volumeChanged(float volume, bool muted);
+protected:
+	void deliver(const AudioEvent &event) override;
 
 private:
+	void onVolumeChangedEvent(float volume, bool muted);
+
 	const GUID _eventContext;
-	ComPtr<IAudioEndpointVolume> volumeControl;
-	ComPtr<IAudioMeterInformation> audioMeterInfo;
+	std::shared_ptr<AudioControlState> controlState;
+	IAudioEndpointVolume *volumeControl;
 	ComPtr<DeviceAudioEvents> volumeEvents;
-	float volumeMindB;
-	float volumeMaxdB;
-	float volumeIncrementdB;
+	VolumeObservers _volumeObservers;
 };
 
 class DeviceAudioEvents final : public IUnknownBase<DeviceAudioEvents, IAudioEndpointVolumeCallback > {
-	DeviceAudioControl &session;
-
-	bool isApplicationEvent(LPCGUID context);
+	// nullptr once detached
+	DeviceAudioControl *control;
+	const GUID eventContext;
+	QMutex mutex;
 
 public:
-	DeviceAudioEvents(DeviceAudioControl &session) : session(session) {}
+	DeviceAudioEvents(DeviceAudioControl &control) : control(&control), eventContext(control.eventContext()) {}
+
+	// Stops forwarding to the control, returns once a callback forwarding right now is done
+	void detach();
 
 	HRESULT STDMETHODCALLTYPE OnNotify(AUDIO_VOLUME_NOTIFICATION_DATA *pNotify) override;
 };
 
 class AudioSessionPidGroup;
 
-class AudioSession final : public QObject, public IAudioControl {
-	Q_OBJECT
+// Observers are notified on the GUI thread
+class AudioSession final : public IAudioControl, public AudioEventSource {
 public:
+	using VolumeObservers = ObserverList<float, bool>;
+	using StateObservers = ObserverList<int>;
+	// nullptr when the session left its grouping
+	using GroupingParamObservers = ObserverList<const GUID *>;
+
 	enum class State {
 		Inactive = 0,
 		Active = 1,
@@ -197,6 +228,11 @@ public:
 
 	std::optional<DWORD> pid() const;
 
+	std::optional<GUID> groupingParam() const;
+
+	// Folds the peaks of this session into aggregate, nullptr stops it
+	void setPeakAggregate(std::shared_ptr<PeakAggregate> aggregate);
+
 	const GUID &eventContext() const { return _eventContext; }
 
 	IAudioSessionControl2 &control() { return *_sessionControl; }
@@ -204,23 +240,34 @@ public:
 	const AudioSessionPidGroup *parent() const { return _parent; }
 	AudioSessionPidGroup *parent() { return _parent; }
 
+	VolumeObservers &volumeObservers() { return _volumeObservers; }
+	StateObservers &stateObservers() { return _stateObservers; }
+	GroupingParamObservers &groupingParamObservers() { return _groupingParamObservers; }
+
+protected:
+	void deliver(const AudioEvent &event) override;
+
 private:
 	void onVolumeChangedEvent(float newVolume, bool newMute);
 	void onStateChangedEvent(AudioSessionState newState);
 	void onGroupingParamChangedEvent(LPCGUID newGroupingParam);
 
-signals:
-	void volumeChanged(float newVolume, bool newMute);
-	void stateChanged(int newState);
-	void groupingParamChanged(const GUID *newGroupingParam);
-
-private:
 	const GUID _eventContext;
 	AudioSessionPidGroup *_parent;
 	ComPtr<IAudioSessionControl2> _sessionControl;
-	ComPtr<ISimpleAudioVolume> volumeControl;
-	ComPtr<IAudioMeterInformation> audioMeterInfo;
-	ComPtr<IAudioSessionEvents> sessionEvents;
+	std::shared_ptr<AudioControlState> controlState;
+	ComPtr<AudioSessionEvents> sessionEvents;
+
+	// queried once, afterwards kept up to date by the session events
+	std::optional<DWORD> _pid;
+	bool _isSystemSound = false;
+	std::atomic<int> _state{AudioSessionStateExpired};
+	mutable QMutex groupingParamMutex;
+	std::optional<GUID> _groupingParam;
+	VolumeObservers _volumeObservers;
+	StateObservers _stateObservers;
+	GroupingParamObservers _groupingParamObservers;
+	MemoryAccount memory;
 };
 
 constexpr const char* ToString(AudioSession::State state) {
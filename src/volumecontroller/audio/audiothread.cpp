@@ -0,0 +1,155 @@
+#include "audiothread.h"
+#include "backendtrace.h"
+#include "volumecontroller/metrics.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <Objbase.h>
+#endif
+
+#include <algorithm>
+
+static Counter &CoalescedWrites(const char *labels) {
+	return Metrics::instance().counter("volumecontroller_events_coalesced_total", "Events folded into a later one instead of being handled", labels);
+}
+
+AudioThread &AudioThread::instance() {
+	static AudioThread audioThread;
+	return audioThread;
+}
+
+AudioThread::AudioThread() {
+	thread.setObjectName("AudioThread");
+	worker.moveToThread(&thread);
+#ifdef Q_OS_WIN
+	connect(&thread, &QThread::started, &worker, []() {
+		CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	}, Qt::DirectConnection);
+	connect(&thread, &QThread::finished, &worker, []() {
+		CoUninitialize();
+	}, Qt::DirectConnection);
+#endif
+	clock.start();
+	thread.start();
+}
+
+AudioThread::~AudioThread() {
+	stop();
+}
+
+void AudioThread::post(std::function<void()> command) {
+	const qint64 postedUs = clock.nsecsElapsed() / 1000;
+	queued.fetch_add(1, std::memory_order_relaxed);
+	QMetaObject::invokeMethod(&worker, [this, command = std::move(command), postedUs]() {
+		run(command, postedUs);
+	}, Qt::QueuedConnection);
+}
+
+void AudioThread::run(const std::function<void()> &command, qint64 postedUs) {
+	const qint64 startUs = clock.nsecsElapsed() / 1000;
+	queued.fetch_sub(1, std::memory_order_relaxed);
+	command();
+	const qint64 runUs = clock.nsecsElapsed() / 1000 - startUs;
+
+	++commands;
+	maxWaitUs = std::max(maxWaitUs, startUs - postedUs);
+	maxRunUs = std::max(maxRunUs, runUs);
+	if(runUs >= BackendTrace::instance().stallThresholdMs() * 1000) {
+		++stalls;
+		qWarning() << "Audio thread command took" << runUs / 1000 << "ms";
+	}
+}
+
+void AudioThread::setVolume(const std::shared_ptr<AudioControlState> &state, float volume) {
+	state->volume = volume;
+	state->pendingVolume = volume;
+	if(state->volumeQueued.exchange(true)) {
+		static Counter &coalesced = CoalescedWrites("type=\"volume\"");
+		coalesced.add();
+		return;
+	}
+	post([state]() {
+		state->volumeQueued = false;
+		if(!state->writeVolume(state->pendingVolume))
+			qDebug() << "Failed to write volume";
+	});
+}
+
+void AudioThread::setMuted(const std::shared_ptr<AudioControlState> &state, bool muted) {
+	state->muted = muted;
+	state->pendingMuted = muted;
+	if(state->mutedQueued.exchange(true)) {
+		static Counter &coalesced = CoalescedWrites("type=\"mute\"");
+		coalesced.add();
+		return;
+	}
+	post([state]() {
+		state->mutedQueued = false;
+		if(!state->writeMuted(state->pendingMuted))
+			qDebug() << "Failed to write mute";
+	});
+}
+
+void AudioThread::addMeter(std::shared_ptr<AudioControlState> state) {
+	QMutexLocker locker(&metersMutex);
+	meters.push_back(std::move(state));
+}
+
+void AudioThread::removeMeter(const AudioControlState *state) {
+	QMutexLocker locker(&metersMutex);
+	meters.erase(std::remove_if(meters.begin(), meters.end(), [=](const std::shared_ptr<AudioControlState> &meter) {
+		return meter.get() == state;
+	}), meters.end());
+}
+
+void AudioThread::pollPeaks() {
+	if(pollQueued.exchange(true))
+		return;
+	post([this]() {
+		pollQueued = false;
+		static LatencyHistogram &pollTime = Metrics::instance().histogram("volumecontroller_meter_poll_seconds", "Duration of reading all peak meters");
+		ScopedLatency latency(pollTime);
+		std::vector<std::shared_ptr<AudioControlState>> polled;
+		{
+			QMutexLocker locker(&metersMutex);
+			polled = meters;
+		}
+		++pollBatch;
+		std::vector<PeakAggregate*> aggregates;
+		for(auto &state : polled) {
+			float value;
+			const float peak = state->readPeak(value) ? value : 0.0f;
+			state->peak = peak;
+			const auto aggregate = state->aggregate.get();
+			if(!aggregate)
+				continue;
+			if(aggregate->batch != pollBatch) {
+				aggregate->batch = pollBatch;
+				aggregate->pending = 0.0f;
+				aggregates.push_back(aggregate);
+			}
+			aggregate->pending = std::max(aggregate->pending, peak);
+		}
+		for(auto aggregate : aggregates)
+			aggregate->published = aggregate->pending;
+	});
+}
+
+void AudioThread::setPeakAggregate(const std::shared_ptr<AudioControlState> &state, std::shared_ptr<PeakAggregate> aggregate) {
+	post([state, aggregate = std::move(aggregate)]() mutable {
+		state->aggregate = std::move(aggregate);
+	});
+}
+
+void AudioThread::stop() {
+	if(!thread.isRunning())
+		return;
+	// queued behind all pending commands
+	QMetaObject::invokeMethod(&worker, [this]() {
+		qDebug() << "Audio thread ran" << commands << "commands, max wait" << maxWaitUs << "us, max run" << maxRunUs << "us,"
+					<< stalls << "stalls";
+		thread.quit();
+	}, Qt::QueuedConnection);
+	thread.wait();
+}
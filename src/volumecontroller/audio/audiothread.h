@@ -0,0 +1,107 @@
+#ifndef AUDIOTHREAD_H
+#define AUDIOTHREAD_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Maximum peak of several controls, folded in while their meters are polled
+class PeakAggregate {
+public:
+	float value() const { return published.load(); }
+
+private:
+	friend class AudioThread;
+
+	// only used on the audio thread
+	quint64 batch = 0;
+	float pending = 0.0f;
+
+	std::atomic<float> published{0.0f};
+};
+
+// Backend and cached values of one volume control. Shared by its owner on the GUI thread and the commands
+// queued on the audio thread, the backend objects are released once the last queued command ran.
+class AudioControlState {
+public:
+	virtual ~AudioControlState() = default;
+
+	// Blocking backend calls, only made on the audio thread
+	virtual bool readPeak(float &value) = 0;
+	virtual bool writeVolume(float value) = 0;
+	virtual bool writeMuted(bool value) = 0;
+
+	std::atomic<float> volume{0.0f};
+	std::atomic<bool> muted{false};
+	std::atomic<float> peak{0.0f};
+
+	// only the latest value requested while a write is queued is written
+	std::atomic<float> pendingVolume{0.0f};
+	std::atomic<bool> volumeQueued{false};
+	std::atomic<bool> pendingMuted{false};
+	std::atomic<bool> mutedQueued{false};
+
+	// only used on the audio thread, set with AudioThread::setPeakAggregate
+	std::shared_ptr<PeakAggregate> aggregate;
+};
+
+// Runs every blocking backend call off the GUI thread. Commands run in the order they were posted.
+class AudioThread : public QObject {
+	Q_OBJECT
+
+public:
+	static AudioThread &instance();
+
+	~AudioThread();
+
+	void post(std::function<void()> command);
+
+	// Update the cached value right away and write it to the backend on the audio thread
+	void setVolume(const std::shared_ptr<AudioControlState> &state, float volume);
+	void setMuted(const std::shared_ptr<AudioControlState> &state, bool muted);
+
+	// Folds the peaks of state into aggregate from the next poll on, nullptr stops it
+	void setPeakAggregate(const std::shared_ptr<AudioControlState> &state, std::shared_ptr<PeakAggregate> aggregate);
+
+	void addMeter(std::shared_ptr<AudioControlState> state);
+	void removeMeter(const AudioControlState *state);
+
+	// Reads all meters in one batch into AudioControlState::peak, a poll still queued is not queued again
+	void pollPeaks();
+
+	// Commands posted but not yet run
+	int queueDepth() const { return queued.load(std::memory_order_relaxed); }
+
+	// Runs the queued commands and stops the thread
+	void stop();
+
+private:
+	AudioThread();
+
+	void run(const std::function<void()> &command, qint64 postedUs);
+
+	QThread thread;
+	QObject worker;
+	QElapsedTimer clock;
+
+	QMutex metersMutex;
+	std::vector<std::shared_ptr<AudioControlState>> meters;
+	std::atomic<bool> pollQueued{false};
+	std::atomic<int> queued{0};
+	// only used on the audio thread
+	quint64 pollBatch = 0;
+
+	// only used on the audio thread
+	qint64 commands = 0;
+	qint64 stalls = 0;
+	qint64 maxWaitUs = 0;
+	qint64 maxRunUs = 0;
+};
+
+#endif // AUDIOTHREAD_H
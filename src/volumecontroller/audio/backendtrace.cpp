@@ -0,0 +1,110 @@
+#include "backendtrace.h"
+#include "volumecontroller/metrics.h"
+
+#include <QDebug>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+const char *ToString(BackendMethod method) {
+	switch(method) {
+	case BackendMethod::QueryInterface:
+		return "QueryInterface";
+	case BackendMethod::RegisterNotification:
+		return "RegisterNotification";
+	case BackendMethod::UnregisterNotification:
+		return "UnregisterNotification";
+	case BackendMethod::GetMasterVolume:
+		return "GetMasterVolume";
+	case BackendMethod::SetMasterVolume:
+		return "SetMasterVolume";
+	case BackendMethod::GetMute:
+		return "GetMute";
+	case BackendMethod::SetMute:
+		return "SetMute";
+	case BackendMethod::GetPeakValue:
+		return "GetPeakValue";
+	case BackendMethod::GetState:
+		return "GetState";
+	case BackendMethod::GetProcessId:
+		return "GetProcessId";
+	case BackendMethod::GetGroupingParam:
+		return "GetGroupingParam";
+	case BackendMethod::IsSystemSoundsSession:
+		return "IsSystemSoundsSession";
+	case BackendMethod::Count:
+		break;
+	}
+	return "Undefined";
+}
+
+void LatencyHistogram::record(qint64 us) {
+	const int bucket = us < 2 ? 0 : std::min(bucketCount - 1, 63 - int(qCountLeadingZeroBits(quint64(us))));
+	buckets[size_t(bucket)].fetch_add(1, std::memory_order_relaxed);
+	_count.fetch_add(1, std::memory_order_relaxed);
+	totalUs.fetch_add(us, std::memory_order_relaxed);
+	qint64 max = _maxUs.load(std::memory_order_relaxed);
+	while(us > max && !_maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+}
+
+qreal LatencyHistogram::averageUs() const {
+	const auto n = count();
+	return n > 0 ? qreal(totalUs.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+qint64 LatencyHistogram::percentileUs(qreal percentile) const {
+	const auto n = count();
+	if(n == 0)
+		return 0;
+	const quint64 target = quint64(percentile * n);
+	quint64 seen = 0;
+	for(int i = 0; i < bucketCount; ++i) {
+		seen += buckets[size_t(i)].load(std::memory_order_relaxed);
+		if(seen > target)
+			return bucketUpperBoundUs(i);
+	}
+	return bucketUpperBoundUs(bucketCount - 1);
+}
+
+BackendTrace &BackendTrace::instance() {
+	static BackendTrace trace;
+	return trace;
+}
+
+BackendTrace::BackendTrace() {
+	clock.start();
+	for(size_t i = 0; i < histograms.size(); ++i) {
+		const QByteArray labels = QByteArray("method=\"") + ToString(BackendMethod(i)) + '"';
+		Metrics::instance().addHistogram("volumecontroller_backend_call_seconds", "Duration of backend calls", labels.constData(), histograms[i]);
+	}
+}
+
+void BackendTrace::finish(BackendMethod method, const char *context, qint64 us) {
+	histograms[size_t(method)].record(us);
+	if(us < stallThresholdUs.load(std::memory_order_relaxed))
+		return;
+	_stalls.fetch_add(1, std::memory_order_relaxed);
+	qWarning().nospace() << "Backend stall: " << ToString(method) << " took " << us / 1000.0 << " ms in " << context;
+}
+
+QString BackendTrace::summary() const {
+	QString text = QString("Backend calls, stall threshold %1 ms, %2 stalls\n").arg(stallThresholdMs()).arg(stalls());
+	for(size_t i = 0; i < histograms.size(); ++i) {
+		const auto &histogram = histograms[i];
+		if(histogram.count() == 0)
+			continue;
+		text += QString("%1 %2 calls, avg %3 us, p50 < %4 us, p99 < %5 us, max %6 us\n")
+				.arg(ToString(BackendMethod(i)), -22)
+				.arg(histogram.count(), 8)
+				.arg(histogram.averageUs(), 0, 'f', 1)
+				.arg(histogram.percentileUs(0.5))
+				.arg(histogram.percentileUs(0.99))
+				.arg(histogram.maxUs());
+	}
+	return text;
+}
+
+void BackendTrace::logSummary() const {
+	for(const auto &line : summary().split('\n', Qt::SkipEmptyParts))
+		qDebug().noquote() << line;
+}
@@ -0,0 +1,89 @@
+#ifndef BACKENDTRACE_H
+#define BACKENDTRACE_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <array>
+#include <atomic>
+
+// Times a backend call, the context tag is reported with calls slower than the stall threshold
+#define BACKEND_CALL(method, context, expr) \
+	BackendTrace::instance().call(BackendMethod::method, context, [&]() { return (expr); })
+
+enum class BackendMethod {
+	QueryInterface,
+	RegisterNotification,
+	UnregisterNotification,
+	GetMasterVolume,
+	SetMasterVolume,
+	GetMute,
+	SetMute,
+	GetPeakValue,
+	GetState,
+	GetProcessId,
+	GetGroupingParam,
+	IsSystemSoundsSession,
+	Count
+};
+
+const char *ToString(BackendMethod method);
+
+// Power of two buckets in microseconds, lock free
+class LatencyHistogram {
+public:
+	static constexpr int bucketCount = 24;
+
+	void record(qint64 us);
+
+	quint64 count() const { return _count.load(std::memory_order_relaxed); }
+	qint64 maxUs() const { return _maxUs.load(std::memory_order_relaxed); }
+	qint64 sumUs() const { return totalUs.load(std::memory_order_relaxed); }
+	quint64 bucket(int index) const { return buckets[size_t(index)].load(std::memory_order_relaxed); }
+	qreal averageUs() const;
+	// upper bound of the bucket containing the percentile
+	qint64 percentileUs(qreal percentile) const;
+
+	static qint64 bucketUpperBoundUs(int bucket) { return qint64(1) << (bucket + 1); }
+
+private:
+	std::array<std::atomic<quint32>, bucketCount> buckets{};
+	std::atomic<quint64> _count{0};
+	std::atomic<qint64> totalUs{0};
+	std::atomic<qint64> _maxUs{0};
+};
+
+class BackendTrace {
+public:
+	static BackendTrace &instance();
+
+	template<typename F>
+	auto call(BackendMethod method, const char *context, F &&f) {
+		const qint64 start = clock.nsecsElapsed();
+		auto result = f();
+		finish(method, context, (clock.nsecsElapsed() - start) / 1000);
+		return result;
+	}
+
+	void setStallThresholdMs(int value) { stallThresholdUs = qint64(value) * 1000; }
+	int stallThresholdMs() const { return int(stallThresholdUs / 1000); }
+
+	quint64 stalls() const { return _stalls.load(std::memory_order_relaxed); }
+
+	const LatencyHistogram &histogram(BackendMethod method) const { return histograms[size_t(method)]; }
+
+	QString summary() const;
+	void logSummary() const;
+
+private:
+	BackendTrace();
+
+	void finish(BackendMethod method, const char *context, qint64 us);
+
+	QElapsedTimer clock;
+	std::array<LatencyHistogram, size_t(BackendMethod::Count)> histograms;
+	std::atomic<qint64> stallThresholdUs{100000};
+	std::atomic<quint64> _stalls{0};
+};
+
+#endif // BACKENDTRACE_H
@@ -0,0 +1,34 @@
+#include "executablegroup.h"
+
+#include <algorithm>
+
+ExecutableGroup::ExecutableGroup() : aggregate(std::make_shared<PeakAggregate>()) {}
+
+ExecutableGroup::~ExecutableGroup() {
+	for(auto session : _members)
+		session->setPeakAggregate(nullptr);
+}
+
+void ExecutableGroup::setMembers(std::vector<AudioSession*> members) {
+	std::sort(members.begin(), members.end());
+	std::vector<AudioSession*> left;
+	std::set_difference(_members.begin(), _members.end(), members.begin(), members.end(), std::back_inserter(left));
+	std::vector<AudioSession*> joined;
+	std::set_difference(members.begin(), members.end(), _members.begin(), _members.end(), std::back_inserter(joined));
+
+	for(auto session : left)
+		session->setPeakAggregate(nullptr);
+	for(auto session : joined)
+		session->setPeakAggregate(aggregate);
+	_members = std::move(members);
+}
+
+void ExecutableGroup::setVolume(float volume) {
+	for(auto session : _members)
+		session->setVolume(volume);
+}
+
+void ExecutableGroup::setMuted(bool muted) {
+	for(auto session : _members)
+		session->setMuted(muted);
+}
@@ -0,0 +1,33 @@
+#ifndef EXECUTABLEGROUP_H
+#define EXECUTABLEGROUP_H
+
+#include "volumecontroller/audio/audiosessions.h"
+
+#include <memory>
+#include <vector>
+
+// Sessions of all processes of one executable, controlled as one
+class ExecutableGroup {
+public:
+	Q_DISABLE_COPY_MOVE(ExecutableGroup);
+
+	ExecutableGroup();
+	// Detaches the members, so the audio thread stops folding their peaks. They have to be alive.
+	~ExecutableGroup();
+
+	// Only the sessions that joined or left are touched
+	void setMembers(std::vector<AudioSession*> members);
+	const std::vector<AudioSession*> &members() const { return _members; }
+
+	void setVolume(float volume);
+	void setMuted(bool muted);
+
+	// Maximum member peak of the last meter poll
+	float peakValue() const { return std::min(aggregate->value(), 1.0f); }
+
+private:
+	std::vector<AudioSession*> _members;
+	const std::shared_ptr<PeakAggregate> aggregate;
+};
+
+#endif // EXECUTABLEGROUP_H
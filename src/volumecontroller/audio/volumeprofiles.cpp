@@ -0,0 +1,128 @@
+#include "volumeprofiles.h"
+#include "volumecontroller/audio/audiosessions.h"
+#include "volumecontroller/info/processdata.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSettings>
+
+constexpr int saveDelay = 2000;
+
+const struct {
+	QString profiles = "profiles";
+	QString executable = "executable";
+	QString volume = "volume";
+	QString muted = "muted";
+} profileKeys;
+
+VolumeProfiles::VolumeProfiles(QString path, QObject *parent) : QObject(parent), path(std::move(path)) {
+	savePool.setMaxThreadCount(1);
+	saveTimer.setSingleShot(true);
+	saveTimer.setInterval(saveDelay);
+	connect(&saveTimer, &QTimer::timeout, this, &VolumeProfiles::save);
+	load();
+}
+
+VolumeProfiles::~VolumeProfiles() {
+	if(saveTimer.isActive()) {
+		saveTimer.stop();
+		save();
+	}
+	savePool.waitForDone();
+}
+
+QString VolumeProfiles::key(const QString &executable, bool isSystemSound) {
+	if(isSystemSound)
+		return QStringLiteral("systemsounds");
+	return executable.toLower();
+}
+
+std::optional<VolumeProfile> VolumeProfiles::find(const QString &key) const {
+	QReadLocker locker(&lock);
+	const auto it = profiles.constFind(key);
+	if(it == profiles.constEnd())
+		return {};
+	return *it;
+}
+
+void VolumeProfiles::store(const QString &key, VolumeProfile profile) {
+	if(key.isEmpty())
+		return;
+	{
+		QWriteLocker locker(&lock);
+		profiles.insert(key, profile);
+	}
+	saveTimer.start();
+}
+
+bool VolumeProfiles::apply(AudioSession &session) const {
+	const bool isSystemSound = session.isSystemSound();
+	QString executable;
+	if(!isSystemSound) {
+		const auto pid = session.pid();
+		if(!pid)
+			return false;
+		executable = ProcessData::GetProcessPath(*pid).value_or(QString());
+		if(executable.isEmpty())
+			return false;
+	}
+
+	const auto profile = find(key(executable, isSystemSound));
+	if(!profile)
+		return false;
+
+	qDebug() << "Applying profile of" << key(executable, isSystemSound) << "volume" << profile->volume << "muted" << profile->muted;
+	session.setVolume(profile->volume);
+	session.setMuted(profile->muted);
+	return true;
+}
+
+int VolumeProfiles::size() const {
+	QReadLocker locker(&lock);
+	return profiles.size();
+}
+
+void VolumeProfiles::load() {
+	QSettings settings(path, QSettings::IniFormat);
+	const int count = settings.beginReadArray(profileKeys.profiles);
+	QWriteLocker locker(&lock);
+	profiles.reserve(count);
+	for(int i = 0; i < count; ++i) {
+		settings.setArrayIndex(i);
+		const auto executable = settings.value(profileKeys.executable).toString();
+		if(executable.isEmpty())
+			continue;
+		profiles.insert(executable, VolumeProfile{
+								 settings.value(profileKeys.volume, 1.0f).toFloat(),
+								 settings.value(profileKeys.muted, false).toBool()
+							 });
+	}
+	settings.endArray();
+	qDebug() << "Loaded" << profiles.size() << "volume profiles from" << path;
+}
+
+void VolumeProfiles::save() {
+	QHash<QString, VolumeProfile> copy;
+	{
+		QReadLocker locker(&lock);
+		copy = profiles;
+	}
+
+	savePool.start([path = path, profiles = std::move(copy)]() {
+		QElapsedTimer timer;
+		timer.start();
+		QSettings settings(path, QSettings::IniFormat);
+		settings.remove(profileKeys.profiles);
+		settings.beginWriteArray(profileKeys.profiles, profiles.size());
+		int i = 0;
+		for(auto it = profiles.constBegin(); it != profiles.constEnd(); ++it, ++i) {
+			settings.setArrayIndex(i);
+			settings.setValue(profileKeys.executable, it.key());
+			settings.setValue(profileKeys.volume, it->volume);
+			settings.setValue(profileKeys.muted, it->muted);
+		}
+		settings.endArray();
+		settings.sync();
+		qDebug() << "Saved" << profiles.size() << "volume profiles in" << timer.elapsed() << "ms";
+	});
+}
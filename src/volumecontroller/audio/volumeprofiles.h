@@ -0,0 +1,51 @@
+#ifndef VOLUMEPROFILES_H
+#define VOLUMEPROFILES_H
+
+#include <QHash>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <optional>
+
+class AudioSession;
+
+struct VolumeProfile {
+	float volume;
+	bool muted;
+};
+
+// Stored volume and mute per executable. Lookups are thread safe and may happen on the COM notification threads,
+// changes are made on the GUI thread and written to disk debounced on a thread of its own.
+class VolumeProfiles : public QObject {
+	Q_OBJECT
+
+public:
+	VolumeProfiles(QString path, QObject *parent = nullptr);
+	~VolumeProfiles();
+
+	static QString key(const QString &executable, bool isSystemSound);
+
+	std::optional<VolumeProfile> find(const QString &key) const;
+	void store(const QString &key, VolumeProfile profile);
+
+	// Applies the stored profile of the session's executable, returns whether one was found
+	bool apply(AudioSession &session) const;
+
+	int size() const;
+
+private:
+	void load();
+	void save();
+
+	const QString path;
+	mutable QReadWriteLock lock;
+	QHash<QString, VolumeProfile> profiles;
+	QTimer saveTimer;
+	// single thread, saves run in order and shutdown only waits for them
+	QThreadPool savePool;
+};
+
+#endif // VOLUMEPROFILES_H
@@ -0,0 +1,103 @@
+#include "commandchannel.h"
+
+#include <Windows.h>
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QLocalSocket>
+#include <QThread>
+
+constexpr int connectRetryDelay = 20;
+
+QString CommandChannel::serverName() {
+	return "volumecontroller-" + qEnvironmentVariable("USERNAME");
+}
+
+std::optional<QString> CommandChannel::forward(const QStringList &command, int timeoutMs) {
+	QDeadlineTimer deadline(timeoutMs);
+	QLocalSocket socket;
+	// the running instance may still be starting up and not listen yet
+	while(true) {
+		socket.connectToServer(serverName());
+		if(socket.waitForConnected(int(deadline.remainingTime())))
+			break;
+		if(deadline.hasExpired()) {
+			qWarning() << "Could not connect to the running instance:" << socket.errorString();
+			return {};
+		}
+		QThread::msleep(connectRetryDelay);
+	}
+
+	// lets the running instance bring its window to the foreground
+	AllowSetForegroundWindow(ASFW_ANY);
+
+	QDataStream out(&socket);
+	out.setVersion(QDataStream::Qt_5_12);
+	out << command;
+	if(!socket.waitForBytesWritten(int(deadline.remainingTime()))) {
+		qWarning() << "Could not send command:" << socket.errorString();
+		return {};
+	}
+
+	QDataStream in(&socket);
+	in.setVersion(QDataStream::Qt_5_12);
+	QString reply;
+	while(true) {
+		in.startTransaction();
+		in >> reply;
+		if(in.commitTransaction())
+			return reply;
+		if(deadline.hasExpired() || !socket.waitForReadyRead(int(deadline.remainingTime()))) {
+			qWarning() << "No reply from the running instance:" << socket.errorString();
+			return {};
+		}
+	}
+}
+
+CommandServer::CommandServer(Handler handler, QObject *parent) : QObject(parent), handler(std::move(handler)) {
+	server.setSocketOptions(QLocalServer::UserAccessOption);
+	connect(&server, &QLocalServer::newConnection, this, &CommandServer::onNewConnection);
+}
+
+bool CommandServer::listen() {
+	const QString name = CommandChannel::serverName();
+	// a crashed instance may have left the name behind
+	QLocalServer::removeServer(name);
+	if(!server.listen(name)) {
+		qWarning() << "Could not listen for commands on" << name << ":" << server.errorString();
+		return false;
+	}
+	qDebug() << "Listening for commands on" << server.fullServerName();
+	return true;
+}
+
+void CommandServer::onNewConnection() {
+	while(QLocalSocket *socket = server.nextPendingConnection()) {
+		connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+		connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+		if(socket->bytesAvailable() > 0)
+			onReadyRead(socket);
+	}
+}
+
+void CommandServer::onReadyRead(QLocalSocket *socket) {
+	QDataStream in(socket);
+	in.setVersion(QDataStream::Qt_5_12);
+	in.startTransaction();
+	QStringList command;
+	in >> command;
+	if(!in.commitTransaction())
+		return;
+
+	qDebug() << "Received command" << command;
+	const QString error = handler(command);
+	if(!error.isEmpty())
+		qWarning() << "Command" << command << "failed:" << error;
+
+	QDataStream out(socket);
+	out.setVersion(QDataStream::Qt_5_12);
+	out << error;
+	socket->flush();
+	socket->disconnectFromServer();
+}
@@ -0,0 +1,40 @@
+#ifndef COMMANDCHANNEL_H
+#define COMMANDCHANNEL_H
+
+#include <QLocalServer>
+#include <QObject>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+class QLocalSocket;
+
+// Local socket through which further launches forward their command line to the running instance
+namespace CommandChannel {
+	QString serverName();
+
+	// Blocking client, usable before any QCoreApplication exists. Returns the reply, empty on success.
+	std::optional<QString> forward(const QStringList &command, int timeoutMs);
+}
+
+class CommandServer : public QObject {
+	Q_OBJECT
+
+public:
+	// The handler returns an error message, or an empty string on success
+	using Handler = std::function<QString(const QStringList &command)>;
+
+	CommandServer(Handler handler, QObject *parent = nullptr);
+
+	bool listen();
+
+private:
+	void onNewConnection();
+	void onReadyRead(QLocalSocket *socket);
+
+	QLocalServer server;
+	Handler handler;
+};
+
+#endif // COMMANDCHANNEL_H
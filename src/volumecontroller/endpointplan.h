@@ -0,0 +1,64 @@
+#ifndef ENDPOINTPLAN_H
+#define ENDPOINTPLAN_H
+#include <algorithm>
+#include <vector>
+
+// Sections after a device change, built from the ids of the active endpoints
+template<typename Section>
+struct EndpointPlan {
+	static constexpr size_t npos = size_t(-1);
+
+	struct Entry {
+		// the kept section, only set if opened is npos
+		Section section{};
+		// position of the endpoint of a new section in the opened endpoints
+		size_t opened = npos;
+	};
+
+	// one entry per active endpoint in the order of the ids, endpoints without section that were not opened are left out
+	std::vector<Entry> sections;
+	// current sections without active endpoint, in their current order
+	std::vector<Section> removed;
+
+	// nothing to show, the current sections are kept
+	bool empty() const noexcept { return sections.empty(); }
+
+	// the tray follows the first section, that is the default endpoint if it could be opened
+	const Entry &primary() const { return sections.front(); }
+};
+
+// Keeps the current sections of active endpoints and uses the opened endpoints for the others. Has no widget
+// dependencies, the ids of sections and opened endpoints are read with sectionId and openedId.
+template<typename Id, typename Section, typename SectionId, typename Opened, typename OpenedId>
+EndpointPlan<Section> PlanEndpoints(const std::vector<Id> &ids, const std::vector<Section> &current, SectionId sectionId,
+												const std::vector<Opened> &opened, OpenedId openedId) {
+	using Plan = EndpointPlan<Section>;
+	Plan plan;
+	plan.sections.reserve(ids.size());
+	std::vector<bool> kept(current.size(), false);
+	for(const Id &id : ids) {
+		const auto existing = std::find_if(current.begin(), current.end(), [&](const Section &section) {
+			return sectionId(section) == id;
+		});
+		if(existing != current.end()) {
+			kept[size_t(existing - current.begin())] = true;
+			plan.sections.push_back({*existing, Plan::npos});
+			continue;
+		}
+		const auto it = std::find_if(opened.begin(), opened.end(), [&](const Opened &endpoint) {
+			return openedId(endpoint) == id;
+		});
+		if(it != opened.end())
+			plan.sections.push_back({Section{}, size_t(it - opened.begin())});
+	}
+	if(plan.empty())
+		return plan;
+
+	for(size_t i = 0; i < current.size(); ++i) {
+		if(!kept[i])
+			plan.removed.push_back(current[i]);
+	}
+	return plan;
+}
+
+#endif // ENDPOINTPLAN_H
@@ -0,0 +1,49 @@
+#include "collation.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace Collation {
+
+QByteArray SortKey(const QString &text) {
+#ifdef Q_OS_WIN
+	const auto source = reinterpret_cast<LPCWSTR>(text.utf16());
+	constexpr DWORD flags = LCMAP_SORTKEY | LINGUISTIC_IGNORECASE | SORT_DIGITSASNUMBERS;
+	const int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, source, text.size(), nullptr, 0, nullptr, nullptr, 0);
+	if(size > 0) {
+		QByteArray key(size, Qt::Uninitialized);
+		// sort keys are bytes, the size is in bytes as well
+		if(LCMapStringEx(LOCALE_NAME_USER_DEFAULT, flags, source, text.size(), reinterpret_cast<LPWSTR>(key.data()), size, nullptr, nullptr, 0) == size)
+			return key;
+	}
+
+	qDebug() << "Failed to create sort key for" << text << GetLastError();
+#endif
+	const QString folded = text.toCaseFolded();
+	QByteArray key;
+	key.reserve(folded.size() * 2 + 2);
+	for(const QChar c : folded) {
+		key.append(char(c.unicode() >> 8));
+		key.append(char(c.unicode() & 0xff));
+	}
+	key.append(2, '\0');
+	return key;
+}
+
+void AppendTieBreaker(QByteArray &key, quint32 value) {
+	for(int shift = 24; shift >= 0; shift -= 8)
+		key.append(char((value >> shift) & 0xff));
+}
+
+bool Less(const QByteArray &a, const QByteArray &b) noexcept {
+	const int result = std::memcmp(a.constData(), b.constData(), size_t(std::min(a.size(), b.size())));
+	return result < 0 || (result == 0 && a.size() < b.size());
+}
+
+}
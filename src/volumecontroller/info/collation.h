@@ -0,0 +1,20 @@
+#ifndef COLLATION_H
+#define COLLATION_H
+
+#include <QByteArray>
+#include <QString>
+
+namespace Collation {
+	// Locale aware key of text for the user locale, case insensitive and with digits sorted as numbers.
+	// Keys compared with Less order like the texts they were made from. Other platforms than Windows get a
+	// case folded key without locale rules.
+	QByteArray SortKey(const QString &text);
+
+	// Appends value big endian, so keys with the same prefix order by it
+	void AppendTieBreaker(QByteArray &key, quint32 value);
+
+	// Bytewise comparison, embedded zero bytes included
+	bool Less(const QByteArray &a, const QByteArray &b) noexcept;
+}
+
+#endif // COLLATION_H
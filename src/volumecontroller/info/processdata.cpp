@@ -3,58 +3,168 @@
 #include <Shlobj.h>
 #include <shellapi.h>
 #include <Knownfolders.h>
-#include <QtWinExtras/QtWinExtras>
 #include "winver.h"
 
 #include "volumecontroller/hresulterrors.h"
 #include "volumecontroller/comptr.h"
+#include "windowmap.h"
+#include "volumecontroller/metrics.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <atomic>
 
 namespace ProcessData {
 
-std::optional<QPixmap> GetIcon(PCWSTR path, bool isDesktopApp, int cx, int cy) {
-	IShellItem2 *item;
-	const auto err = isDesktopApp ? SHCreateItemFromParsingName(path, nullptr, __uuidof(IShellItem2), (void**)&item)
-										 : SHCreateItemInKnownFolder(FOLDERID_AppsFolder, KF_FLAG_DONT_VERIFY, path, __uuidof(IShellItem2), (void**)&item);
-	RET_EMPTY(err);
+namespace {
+
+struct {
+	std::atomic<quint64> images{0};
+	std::atomic<quint64> copies{0};
+	std::atomic<quint64> bytesCopied{0};
+	std::atomic<quint64> conversions{0};
+} imageTotals;
+
+void AddToTotals(const ImageStatistics &statistics) {
+	imageTotals.images += statistics.images;
+	imageTotals.copies += statistics.copies;
+	imageTotals.bytesCopied += statistics.bytesCopied;
+	imageTotals.conversions += statistics.conversions;
+}
+
+// Copies the bitmap's pixels as top down 32 bit BGRA, which is the memory layout of QImage's 32 bit formats
+std::optional<QImage> ReadBitmap(HBITMAP bitmap, QImage::Format format, ImageStatistics &statistics) {
+	BITMAP header;
+	if(!GetObject(bitmap, sizeof(header), &header))
+		return {};
 
-	IShellItemImageFactory *factory;
-	RET_EMPTY(item->QueryInterface(__uuidof(IShellItemImageFactory), (void**)&factory));
+	QImage image(header.bmWidth, header.bmHeight, format);
+	if(image.isNull())
+		return {};
+
+	BITMAPINFO info = {};
+	info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	info.bmiHeader.biWidth = header.bmWidth;
+	info.bmiHeader.biHeight = -header.bmHeight;
+	info.bmiHeader.biPlanes = 1;
+	info.bmiHeader.biBitCount = 32;
+	info.bmiHeader.biCompression = BI_RGB;
+
+	HDC dc = GetDC(nullptr);
+	const int lines = GetDIBits(dc, bitmap, 0, UINT(header.bmHeight), image.bits(), &info, DIB_RGB_COLORS);
+	ReleaseDC(nullptr, dc);
+	if(lines != header.bmHeight)
+		return {};
+
+	++statistics.copies;
+	statistics.bytesCopied += quint64(image.sizeInBytes());
+	return image;
+}
+
+std::optional<QImage> ImageFromIcon(HICON icon, ImageStatistics &statistics) {
+	ICONINFO iconInfo;
+	if(!GetIconInfo(icon, &iconInfo))
+		return {};
+
+	std::optional<QImage> image;
+	if(iconInfo.hbmColor) {
+		// icon pixels have straight alpha
+		image = ReadBitmap(iconInfo.hbmColor, QImage::Format_ARGB32, statistics);
+		if(image) {
+			auto *pixels = reinterpret_cast<QRgb *>(image->bits());
+			const qsizetype count = image->sizeInBytes() / qsizetype(sizeof(QRgb));
+			const bool hasAlpha = std::any_of(pixels, pixels + count, [](QRgb pixel) { return qAlpha(pixel) != 0; });
+			std::optional<QImage> mask;
+			if(!hasAlpha)
+				mask = ReadBitmap(iconInfo.hbmMask, QImage::Format_RGB32, statistics);
+			const auto *maskPixels = mask && mask->size() == image->size() ? reinterpret_cast<const QRgb *>(mask->constBits()) : nullptr;
+			for(qsizetype i = 0; i < count; ++i) {
+				const QRgb pixel = hasAlpha ? pixels[i] : qRgba(qRed(pixels[i]), qGreen(pixels[i]), qBlue(pixels[i]),
+																				maskPixels && (maskPixels[i] & 0xffffff) ? 0 : 255);
+				pixels[i] = qPremultiply(pixel);
+			}
+			++statistics.conversions;
+			// same layout, only the format tag changes
+			image->reinterpretAsFormat(QImage::Format_ARGB32_Premultiplied);
+		}
+	}
+
+	DeleteObject(iconInfo.hbmColor);
+	DeleteObject(iconInfo.hbmMask);
+	return image;
+}
+
+}
+
+ImageStatistics &ImageStatistics::operator+=(const ImageStatistics &other) {
+	images += other.images;
+	copies += other.copies;
+	bytesCopied += other.bytesCopied;
+	conversions += other.conversions;
+	return *this;
+}
+
+ImageStatistics GetImageStatistics() {
+	ImageStatistics statistics;
+	statistics.images = imageTotals.images;
+	statistics.copies = imageTotals.copies;
+	statistics.bytesCopied = imageTotals.bytesCopied;
+	statistics.conversions = imageTotals.conversions;
+	return statistics;
+}
+
+std::optional<QImage> GetIcon(PCWSTR path, bool isDesktopApp, int cx, int cy, ImageStatistics &statistics) {
+	ComPtr<IShellItem2> item;
+	GET_INTO_COMPTR(IShellItem2, item, pItem, RET_EMPTY(isDesktopApp
+			? SHCreateItemFromParsingName(path, nullptr, __uuidof(IShellItem2), (void**)&pItem)
+			: SHCreateItemInKnownFolder(FOLDERID_AppsFolder, KF_FLAG_DONT_VERIFY, path, __uuidof(IShellItem2), (void**)&pItem)));
+
+	ComPtr<IShellItemImageFactory> factory;
+	GET_INTO_COMPTR(IShellItemImageFactory, factory, pFactory, RET_EMPTY(item->QueryInterface(__uuidof(IShellItemImageFactory), (void**)&pFactory)));
 	HBITMAP bitmap;
 	RET_EMPTY(factory->GetImage(SIZE{cx, cy}, SIIGBF_RESIZETOFIT, &bitmap));
 
-	QPixmap map = QtWin::fromHBITMAP(bitmap, QtWin::HBitmapAlpha);
+	// the factory hands out premultiplied alpha
+	auto image = ReadBitmap(bitmap, QImage::Format_ARGB32_Premultiplied, statistics);
 	DeleteObject(bitmap);
-	return map;
+	return image;
 }
 
-struct handle_data {
-	 unsigned long process_id;
-	 HWND window_handle;
-};
+using MainWindowMap = WindowMap<HWND>;
 
-BOOL IsMainWindow(HWND handle)
-{
-	 return GetWindow(handle, GW_OWNER) == (HWND)0 && IsWindowVisible(handle);
-}
+// titles are resolved in bursts at startup and when sessions appear, one pass serves the whole burst
+constexpr std::chrono::seconds mainWindowMapTimeToLive(2);
 
 BOOL CALLBACK EnumWindowsCallback(HWND handle, LPARAM lParam)
 {
-	 handle_data& data = *(handle_data*)lParam;
+	 auto &windows = *(std::vector<MainWindowMap::WindowInfo>*)lParam;
 	 unsigned long process_id = 0;
 	 GetWindowThreadProcessId(handle, &process_id);
-	 if (data.process_id != process_id || !IsMainWindow(handle))
-		  return TRUE;
-	 data.window_handle = handle;
-	 return FALSE;
+	 windows.push_back({process_id, handle, GetWindow(handle, GW_OWNER) != (HWND)0, IsWindowVisible(handle) != FALSE});
+	 return TRUE;
+}
+
+std::vector<MainWindowMap::WindowInfo> EnumerateTopLevelWindows()
+{
+	 QElapsedTimer timer;
+	 timer.start();
+	 std::vector<MainWindowMap::WindowInfo> windows;
+	 EnumWindows(EnumWindowsCallback, (LPARAM)&windows);
+	 qDebug() << "Enumerated" << windows.size() << "top level windows in" << timer.nsecsElapsed() / 1000 << "us";
+	 return windows;
 }
 
 HWND FindMainWindow(DWORD process_id)
 {
-	 handle_data data;
-	 data.process_id = process_id;
-	 data.window_handle = 0;
-	 EnumWindows(EnumWindowsCallback, (LPARAM)&data);
-	 return data.window_handle;
+	 static MainWindowMap mainWindows(EnumerateTopLevelWindows, mainWindowMapTimeToLive);
+	 static Counter &hits = CacheRequests("cache=\"main_windows\",result=\"hit\"");
+	 static Counter &misses = CacheRequests("cache=\"main_windows\",result=\"miss\"");
+	 bool rebuilt;
+	 const auto window = mainWindows.find(process_id, &rebuilt);
+	 (rebuilt ? misses : hits).add();
+	 return window.value_or(HWND(0));
 }
 
 QString GetWindowTitle(HWND window) {
@@ -79,7 +189,7 @@ struct ModuleRelease {
 
 using UniqueModule = std::unique_ptr<std::remove_pointer_t<HMODULE>, ModuleRelease>;
 
-std::optional<QPixmap> GetImageFromFile(LPCWSTR path, int offset, int cx, int cy) {
+std::optional<QImage> GetImageFromFile(LPCWSTR path, int offset, int cx, int cy, ImageStatistics &statistics) {
 	UniqueModule handle(LoadLibraryW(path));
 	if(handle.get() == nullptr)
 		return {};
@@ -97,37 +207,74 @@ std::optional<QPixmap> GetImageFromFile(LPCWSTR path, int offset, int cx, int cy
 	auto iconResData = (PBYTE)LockResource(LoadResource(handle.get(), iconResInfo));
 	auto iconResSize = SizeofResource(handle.get(), iconResInfo);
 	auto iconHandle = CreateIconFromResourceEx(iconResData, iconResSize, true, 0x00030000, cx, cy, LR_DEFAULTCOLOR);
-	return QtWin::fromHICON(iconHandle);
+	if(iconHandle == nullptr)
+		return {};
+	auto image = ImageFromIcon(iconHandle, statistics);
+	DestroyIcon(iconHandle);
+	return image;
 }
 
 bool IsValid(HANDLE handle) {
 	return handle != INVALID_HANDLE_VALUE && handle != nullptr;
 }
 
-std::optional<QPixmap> GetProcessImage(DWORD pid, int cx, int cy) {
-	if(pid == 0) {
-		qDebug() << "Getting image for sytem sounds";
-		constexpr auto imagePath = L"%windir%\\system32\\audiosrv.dll";
-		constexpr int offset = 203;
-		constexpr DWORD bufferSize = 260;
-		WCHAR buffer[bufferSize];
-		auto size = ExpandEnvironmentStringsW(imagePath, buffer, bufferSize);
-		if(size != 0 && size <= bufferSize)
-			return GetImageFromFile(buffer, offset, cx, cy);
-	} else {
-		qDebug() << "Getting image for process" << pid;
-		UniqueHandle handle = UniqueHandle(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, pid));
-		if(IsValid(handle.get())) {
-			wchar_t buffer[260];
-			DWORD size = 260;
-			if(!FAILED(QueryFullProcessImageNameW(handle.get(), 0, buffer, &size))) {
-				return GetIcon(buffer, true, cx, cy);
+std::optional<QImage> GetProcessImage(DWORD pid, int cx, int cy, ImageStatistics &statistics) {
+	ImageStatistics imageStatistics;
+	const auto image = [&]() -> std::optional<QImage> {
+		if(pid == 0) {
+			qDebug() << "Getting image for sytem sounds";
+			constexpr auto imagePath = L"%windir%\\system32\\audiosrv.dll";
+			constexpr int offset = 203;
+			constexpr DWORD bufferSize = 260;
+			WCHAR buffer[bufferSize];
+			auto size = ExpandEnvironmentStringsW(imagePath, buffer, bufferSize);
+			if(size != 0 && size <= bufferSize)
+				return GetImageFromFile(buffer, offset, cx, cy, imageStatistics);
+		} else {
+			qDebug() << "Getting image for process" << pid;
+			UniqueHandle handle = UniqueHandle(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, pid));
+			if(IsValid(handle.get())) {
+				wchar_t buffer[260];
+				DWORD size = 260;
+				if(!FAILED(QueryFullProcessImageNameW(handle.get(), 0, buffer, &size))) {
+					return GetIcon(buffer, true, cx, cy, imageStatistics);
+				}
 			}
 		}
+		return {};
+	}();
+
+	if(!image) {
+		qDebug() << "Failed to get image for process" << pid;
+		return {};
 	}
+	++imageStatistics.images;
+	AddToTotals(imageStatistics);
+	statistics += imageStatistics;
+	return image;
+}
+
+std::optional<QString> GetProcessPath(const DWORD pid) {
+	UniqueHandle handle(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid));
+	if(!IsValid(handle.get()))
+		return {};
+	WCHAR path[MAX_PATH];
+	DWORD size = MAX_PATH;
+	if(!QueryFullProcessImageNameW(handle.get(), 0, path, &size))
+		return {};
+	return QString::fromWCharArray(path, int(size));
+}
 
-	qDebug() << "Failed to get image for process" << pid;
-	return {};
+qint64 GetProcessUptime() {
+	FILETIME creation, exit, kernel, user, now;
+	if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+	GetSystemTimeAsFileTime(&now);
+	const auto toInt = [](const FILETIME &time) {
+		return (qint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	};
+	// FILETIME counts 100 ns intervals
+	return (toInt(now) - toInt(creation)) / 10000;
 }
 
 std::optional<QString> GetDisplayName(const DWORD pid)
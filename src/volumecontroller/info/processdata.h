@@ -4,18 +4,39 @@
 
 #include <optional>
 #include <QString>
-#include <QPixmap>
+#include <QImage>
 
 namespace ProcessData {
+	// Work done to bring icon pixels into their final format
+	struct ImageStatistics {
+		quint64 images = 0;
+		// full pixel copies and their total size
+		quint64 copies = 0;
+		quint64 bytesCopied = 0;
+		// in place passes over the pixels, like premultiplying alpha
+		quint64 conversions = 0;
+
+		ImageStatistics &operator+=(const ImageStatistics &other);
+	};
+
+	// Totals of all decoded images
+	ImageStatistics GetImageStatistics();
+
 	HWND FindMainWindow(DWORD process_id);
 
 	QString GetWindowTitle(HWND window);
 
 	std::optional<QString> GetDisplayName(DWORD pid);
 
-	std::optional<QPixmap> GetImageFromFile(LPCWSTR path, int offset, int cx, int cy);
+	std::optional<QString> GetProcessPath(DWORD pid);
+
+	// Milliseconds since the current process was created
+	qint64 GetProcessUptime();
+
+	// Images are decoded straight into Format_ARGB32_Premultiplied, safe to call from worker threads with COM initialized
+	std::optional<QImage> GetImageFromFile(LPCWSTR path, int offset, int cx, int cy, ImageStatistics &statistics);
 
-	std::optional<QPixmap> GetProcessImage(DWORD pid, int cx, int cy);
+	std::optional<QImage> GetProcessImage(DWORD pid, int cx, int cy, ImageStatistics &statistics);
 };
 
 #endif // PROCESSDATA_H
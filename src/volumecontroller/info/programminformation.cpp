@@ -2,34 +2,63 @@
 
 #include <QString>
 #include <QDebug>
+#include <QPixmap>
 
 #include "processdata.h"
+#include "volumecontroller/metrics.h"
 
-ProgrammInformation::ProgrammInformation(QString title, std::optional<QIcon> icon) : _title(std::move(title)), _icon(std::move(icon)) {}
+ProgrammInformation::ProgrammInformation(QString title, std::optional<QIcon> icon, QString executable)
+	: _title(title), _icon(std::move(icon)), _executable(std::move(executable)), memory(MemoryCategory::Icons, 0, 0) {}
 
-std::unique_ptr<ProgrammInformation> ProgrammInformation::forProcess(const unsigned long pid, const bool isSystemSound, const QSize imgSize)
+ProgrammInformation::ProgrammInformation(ProgrammSource &&source)
+	: _title(source.title), _executable(std::move(source.executable)), memory(MemoryCategory::Icons, 0, 0)
 {
-	QString title;
+	if(source.images.empty())
+		return;
+	qint64 bytes = 0;
+	QIcon icon;
+	for(auto &image : source.images) {
+		bytes += image.sizeInBytes();
+		icon.addPixmap(QPixmap::fromImage(std::move(image)));
+	}
+	_icon = std::move(icon);
+	memory.resize(bytes, 1);
+}
+
+ProgrammSource ProgrammInformation::resolve(const unsigned long pid, const bool isSystemSound, const QSize imgSize, const std::vector<qreal> &devicePixelRatios)
+{
+	static LatencyHistogram &resolveTime = Metrics::instance().histogram("volumecontroller_program_resolve_seconds", "Duration of resolving the title and icons of a process");
+	ScopedLatency latency(resolveTime);
+	ProgrammSource source;
 	if(isSystemSound) {
-		title = "Systemsounds";
+		source.title = "Systemsounds";
 	} else {
+		source.executable = ProcessData::GetProcessPath(pid).value_or(QString());
 		auto strOpt = ProcessData::GetDisplayName(pid);
 		if(strOpt.has_value()) {
-			title = std::move(*strOpt);
+			source.title = std::move(*strOpt);
 		} else {
 			HWND window = ProcessData::FindMainWindow(pid);
-			title = ProcessData::GetWindowTitle(window);
+			source.title = ProcessData::GetWindowTitle(window);
 		}
 	}
 
-	auto optImg = ProcessData::GetProcessImage(pid, imgSize.width(), imgSize.height());
+	ProcessData::ImageStatistics statistics;
+	for(const qreal devicePixelRatio : devicePixelRatios) {
+		const QSize pixelSize = imgSize * devicePixelRatio;
+		auto optImg = ProcessData::GetProcessImage(pid, pixelSize.width(), pixelSize.height(), statistics);
+		if(!optImg.has_value())
+			break;
+		optImg->setDevicePixelRatio(devicePixelRatio);
+		source.images.push_back(std::move(*optImg));
+	}
 
-	qDebug() << "ProgrammInformation for pid" << pid << "has title" << title << "and an icon:" << optImg.has_value();
-	if(!optImg.has_value())
-		return std::make_unique<ProgrammInformation>(title, std::optional<QPixmap>());
+	qDebug() << "ProgrammInformation for pid" << pid << "has title" << source.title << "and" << source.images.size() << "icon images,"
+				<< statistics.copies << "copies of" << statistics.bytesCopied << "bytes," << statistics.conversions << "conversions";
+	return source;
+}
 
-	auto img = optImg->toImage();
-	img.convertTo(QImage::Format_RGBA8888);
-	auto icon = QIcon(QPixmap::fromImage(std::move(img)));
-	return std::make_unique<ProgrammInformation>(std::move(title), std::move(icon));
+std::unique_ptr<ProgrammInformation> ProgrammInformation::forProcess(const unsigned long pid, const bool isSystemSound, const QSize imgSize, const std::vector<qreal> &devicePixelRatios)
+{
+	return std::make_unique<ProgrammInformation>(resolve(pid, isSystemSound, imgSize, devicePixelRatios));
 }
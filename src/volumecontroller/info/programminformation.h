@@ -2,21 +2,45 @@
 #define PROGRAMMINFORMATION_H
 
 #include <optional>
+#include <vector>
 #include <QIcon>
+#include <QImage>
+
+#include "volumecontroller/internedstring.h"
+#include "volumecontroller/memoryaccounting.h"
+
+// What is shown for a process, resolved without creating GUI objects so it can happen on a worker thread
+struct ProgrammSource {
+	QString title;
+	QString executable;
+	// one image per device pixel ratio, in Format_ARGB32_Premultiplied with the ratio set
+	std::vector<QImage> images;
+};
 
 class ProgrammInformation
 {
 public:
-	ProgrammInformation(QString title, std::optional<QIcon> icon);
+	// The icon shares the pixmaps of another program or the snapshot and is not charged to the icon memory again
+	ProgrammInformation(QString title, std::optional<QIcon> icon, QString executable = {});
+	// Wraps the images into pixmaps without copying them, GUI thread only
+	explicit ProgrammInformation(ProgrammSource &&source);
 
-	static std::unique_ptr<ProgrammInformation> forProcess(unsigned long pid, bool isSystemSound, QSize imgSize);
+	static ProgrammSource resolve(unsigned long pid, bool isSystemSound, QSize imgSize, const std::vector<qreal> &devicePixelRatios);
+
+	static std::unique_ptr<ProgrammInformation> forProcess(unsigned long pid, bool isSystemSound, QSize imgSize, const std::vector<qreal> &devicePixelRatios);
 
 	const QString &title() const { return _title; }
+	InternedString titleHandle() const { return _title; }
 	const std::optional<QIcon> &icon() const { return _icon; }
 
+	// Full image path of the process, empty for system sounds or if it could not be queried
+	const QString &executable() const { return _executable; }
+
 private:
-	QString _title;
+	InternedString _title;
 	std::optional<QIcon> _icon;
+	QString _executable;
+	MemoryAccount memory;
 };
 
 #endif // PROGRAMMINFORMATION_H
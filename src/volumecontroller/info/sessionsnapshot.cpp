@@ -0,0 +1,77 @@
+#include "sessionsnapshot.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+constexpr quint32 snapshotMagic = 0x56435353;
+constexpr quint16 snapshotVersion = 1;
+
+bool SessionSnapshot::load(const QString &path) {
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_12);
+	quint32 magic;
+	quint16 version;
+	in >> magic >> version;
+	if(magic != snapshotMagic || version != snapshotVersion) {
+		qDebug() << "Ignoring session snapshot" << path << "with version" << version;
+		return false;
+	}
+
+	qreal devicePixelRatio;
+	QSize windowSize;
+	quint32 count;
+	in >> devicePixelRatio >> windowSize >> count;
+	// every entry holds at least the lengths of its two strings, a larger count comes from a damaged file
+	constexpr qint64 minimumEntryBytes = 2 * qint64(sizeof(quint32));
+	if(in.status() != QDataStream::Ok || qint64(count) > (file.size() - file.pos()) / minimumEntryBytes) {
+		qWarning() << "Session snapshot" << path << "is corrupt";
+		return false;
+	}
+	std::vector<Entry> loaded;
+	loaded.reserve(count);
+	for(quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+		Entry entry;
+		in >> entry.key >> entry.title >> entry.icon;
+		entry.icon.setDevicePixelRatio(devicePixelRatio);
+		loaded.push_back(std::move(entry));
+	}
+	if(in.status() != QDataStream::Ok) {
+		qWarning() << "Session snapshot" << path << "is corrupt";
+		return false;
+	}
+	_devicePixelRatio = devicePixelRatio;
+	_windowSize = windowSize;
+	setEntries(std::move(loaded));
+	return true;
+}
+
+bool SessionSnapshot::save(const QString &path) const {
+	QSaveFile file(path);
+	if(!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_5_12);
+	out << snapshotMagic << snapshotVersion << _devicePixelRatio << _windowSize << quint32(entries.size());
+	for(const auto &entry : entries)
+		out << entry.key << entry.title << entry.icon;
+	return file.commit();
+}
+
+const SessionSnapshot::Entry *SessionSnapshot::find(const QString &key) const {
+	const auto it = index.constFind(key);
+	return it == index.constEnd() ? nullptr : &entries[size_t(*it)];
+}
+
+void SessionSnapshot::setEntries(std::vector<Entry> &&value) {
+	entries = std::move(value);
+	index.clear();
+	for(size_t i = 0; i < entries.size(); ++i)
+		index.insert(entries[i].key, int(i));
+}
@@ -0,0 +1,46 @@
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include <QHash>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+#include <vector>
+
+// What the session list looked like at the last exit. Lets the next start show titles and icons without
+// resolving every process first.
+class SessionSnapshot {
+public:
+	struct Entry {
+		// VolumeProfiles::key() of the program
+		QString key;
+		QString title;
+		QPixmap icon;
+	};
+
+	bool load(const QString &path);
+	bool save(const QString &path) const;
+
+	bool isEmpty() const { return entries.empty(); }
+	int size() const { return int(entries.size()); }
+
+	const Entry *find(const QString &key) const;
+
+	// entries are in row order
+	void setEntries(std::vector<Entry> &&entries);
+
+	qreal devicePixelRatio() const { return _devicePixelRatio; }
+	void setDevicePixelRatio(qreal value) { _devicePixelRatio = value; }
+
+	QSize windowSize() const { return _windowSize; }
+	void setWindowSize(QSize size) { _windowSize = size; }
+
+private:
+	std::vector<Entry> entries;
+	QHash<QString, int> index;
+	qreal _devicePixelRatio = 1.0;
+	QSize _windowSize;
+};
+
+#endif // SESSIONSNAPSHOT_H
@@ -0,0 +1,74 @@
+#ifndef WINDOWMAP_H
+#define WINDOWMAP_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Maps process ids to their first main window in z-order, that is a visible window without owner. Built from a single
+// pass over the top level windows and rebuilt on the next lookup once older than the time to live. Has no platform
+// dependencies, the enumeration is passed in.
+template<typename Window, typename Clock = std::chrono::steady_clock>
+class WindowMap {
+public:
+	struct WindowInfo {
+		unsigned long pid;
+		Window window;
+		bool owned;
+		bool visible;
+	};
+
+	// Returns the top level windows in z-order
+	using Enumerator = std::function<std::vector<WindowInfo>()>;
+
+	WindowMap(Enumerator enumerate, typename Clock::duration timeToLive)
+		: enumerate(std::move(enumerate)), timeToLive(timeToLive) {}
+
+	// rebuilt is set if the lookup had to enumerate the windows again
+	std::optional<Window> find(unsigned long pid, bool *rebuilt = nullptr) {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto now = Clock::now();
+		const bool expired = !built || now - builtAt >= timeToLive;
+		if(expired)
+			rebuild(now);
+		if(rebuilt)
+			*rebuilt = expired;
+		const auto it = windows.find(pid);
+		if(it == windows.end())
+			return {};
+		return it->second;
+	}
+
+	void invalidate() {
+		std::lock_guard<std::mutex> lock(mutex);
+		built = false;
+	}
+
+	size_t rebuilds() const { return _rebuilds; }
+
+private:
+	void rebuild(typename Clock::time_point now) {
+		windows.clear();
+		for(const auto &info : enumerate()) {
+			if(!info.owned && info.visible)
+				windows.emplace(info.pid, info.window);
+		}
+		builtAt = now;
+		built = true;
+		++_rebuilds;
+	}
+
+	Enumerator enumerate;
+	const typename Clock::duration timeToLive;
+
+	std::mutex mutex;
+	std::unordered_map<unsigned long, Window> windows;
+	typename Clock::time_point builtAt;
+	bool built = false;
+	size_t _rebuilds = 0;
+};
+
+#endif // WINDOWMAP_H
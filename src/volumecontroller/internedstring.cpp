@@ -0,0 +1,58 @@
+#include "internedstring.h"
+
+#include <QDebug>
+#include <QMutex>
+
+#include <unordered_set>
+
+namespace {
+
+struct QStringHash {
+	size_t operator()(const QString &value) const noexcept {
+		return qHash(value);
+	}
+};
+
+struct InternTable {
+	QMutex mutex;
+	// node based, so entries keep their address
+	std::unordered_set<QString, QStringHash> strings;
+	InternedString::Statistics statistics;
+};
+
+InternTable &Table() {
+	static InternTable table;
+	return table;
+}
+
+const QString *Intern(const QString &value) {
+	auto &table = Table();
+	QMutexLocker lock(&table.mutex);
+	++table.statistics.lookups;
+	const auto [it, inserted] = table.strings.insert(value);
+	if(inserted)
+		++table.statistics.unique;
+	else if(it->constData() != value.constData())
+		table.statistics.bytesSaved += sizeof(QArrayData) + quint64(value.size() + 1) * sizeof(QChar);
+	return &*it;
+}
+
+}
+
+InternedString::InternedString() {
+	static const QString *empty = Intern(QString());
+	value = empty;
+}
+
+InternedString::InternedString(const QString &value) : value(Intern(value)) {}
+
+InternedString::Statistics InternedString::statistics() {
+	auto &table = Table();
+	QMutexLocker lock(&table.mutex);
+	return table.statistics;
+}
+
+void InternedString::logStatistics() {
+	const auto s = statistics();
+	qDebug().nospace() << "Interned " << s.lookups << " strings into " << s.unique << " entries, saved " << s.bytesSaved << " bytes";
+}
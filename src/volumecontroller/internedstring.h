@@ -0,0 +1,38 @@
+#ifndef INTERNEDSTRING_H
+#define INTERNEDSTRING_H
+
+#include <QString>
+
+// Handle to a string in a global table, equal strings share one entry and compare by pointer.
+// Entries live until the process exits, so only intern strings from a small set like titles.
+class InternedString {
+public:
+	struct Statistics {
+		quint64 lookups = 0;
+		quint64 unique = 0;
+		// bytes of string data that would have been held by separate copies
+		quint64 bytesSaved = 0;
+	};
+
+	InternedString();
+	explicit InternedString(const QString &value);
+
+	const QString &str() const noexcept { return *value; }
+	operator const QString &() const noexcept { return *value; }
+
+	bool operator==(const InternedString &other) const noexcept { return value == other.value; }
+	bool operator!=(const InternedString &other) const noexcept { return value != other.value; }
+
+	static Statistics statistics();
+	static void logStatistics();
+
+private:
+	const QString *value;
+};
+
+// Hashes the entry, not the characters
+inline uint qHash(const InternedString &key, uint seed = 0) noexcept {
+	return qHash(&key.str(), seed);
+}
+
+#endif // INTERNEDSTRING_H
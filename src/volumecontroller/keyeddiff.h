@@ -0,0 +1,101 @@
+#ifndef KEYEDDIFF_H
+#define KEYEDDIFF_H
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+// Edit script turning a list of current rows into a list of target rows
+struct KeyedDiff {
+	static constexpr size_t npos = size_t(-1);
+
+	// current row of every target row, npos for inserted rows
+	std::vector<size_t> sources;
+	// current rows missing from the target, ascending
+	std::vector<size_t> removed;
+	// target rows that are kept but leave their relative order, ascending
+	std::vector<size_t> moved;
+	// target rows without a current row, ascending
+	std::vector<size_t> inserted;
+
+	bool empty() const noexcept {
+		return removed.empty() && moved.empty() && inserted.empty();
+	}
+
+	size_t operationCount() const noexcept {
+		return removed.size() + moved.size() + inserted.size();
+	}
+};
+
+// Positions in values of one longest strictly increasing subsequence, O(n log n)
+template<typename Value>
+std::vector<size_t> LongestIncreasingSubsequence(const std::vector<Value> &values) {
+	// tails[l] is the position of the smallest value ending an increasing run of length l + 1
+	std::vector<size_t> tails;
+	std::vector<size_t> previous(values.size(), KeyedDiff::npos);
+	for(size_t i = 0; i < values.size(); ++i) {
+		const auto it = std::lower_bound(tails.begin(), tails.end(), values[i], [&](size_t position, const Value &value) {
+			return values[position] < value;
+		});
+		if(it != tails.begin())
+			previous[i] = *std::prev(it);
+		if(it == tails.end())
+			tails.push_back(i);
+		else
+			*it = i;
+	}
+
+	std::vector<size_t> result(tails.size());
+	size_t position = tails.empty() ? KeyedDiff::npos : tails.back();
+	for(auto it = result.rbegin(); it != result.rend(); ++it) {
+		*it = position;
+		position = previous[position];
+	}
+	return result;
+}
+
+// Keys have to be unique within current and within target. Kept rows on a longest increasing
+// run of their current rows stay in place, so the number of moves is minimal.
+template<typename Key, typename Hash = std::hash<Key>>
+KeyedDiff ComputeKeyedDiff(const std::vector<Key> &current, const std::vector<Key> &target) {
+	std::unordered_map<Key, size_t, Hash> currentRows;
+	currentRows.reserve(current.size());
+	for(size_t i = 0; i < current.size(); ++i)
+		currentRows.emplace(current[i], i);
+
+	KeyedDiff diff;
+	diff.sources.reserve(target.size());
+	std::vector<bool> kept(current.size());
+	std::vector<size_t> keptSources;
+	std::vector<size_t> keptTargets;
+	for(size_t i = 0; i < target.size(); ++i) {
+		const auto it = currentRows.find(target[i]);
+		if(it == currentRows.end()) {
+			diff.sources.push_back(KeyedDiff::npos);
+			diff.inserted.push_back(i);
+			continue;
+		}
+		diff.sources.push_back(it->second);
+		kept[it->second] = true;
+		keptSources.push_back(it->second);
+		keptTargets.push_back(i);
+	}
+
+	for(size_t i = 0; i < current.size(); ++i) {
+		if(!kept[i])
+			diff.removed.push_back(i);
+	}
+
+	const auto stable = LongestIncreasingSubsequence(keptSources);
+	auto s = stable.begin();
+	for(size_t k = 0; k < keptSources.size(); ++k) {
+		if(s != stable.end() && *s == k) {
+			++s;
+			continue;
+		}
+		diff.moved.push_back(keptTargets[k]);
+	}
+	return diff;
+}
+
+#endif // KEYEDDIFF_H
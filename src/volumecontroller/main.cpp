@@ -1,9 +1,12 @@
 #include "runguard.h"
+#include "commandchannel.h"
+#include "metrics.h"
 #include "volumecontroller/ui/customstyle.h"
 #include "volumecontroller/ui/theme.h"
 #include "volumecontroller/ui/volumecontroller.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QScreen>
 #include <QDebug>
 #include <QPalette>
@@ -14,6 +17,8 @@
 
 const QString logFileName = "VolumeController.log";
 
+constexpr int forwardTimeout = 2000;
+
 static QFile logFile(logFileName);
 static QtMessageHandler defaultMessageHandler;
 
@@ -21,10 +26,15 @@ void messageHandler(QtMsgType type, const QMessageLogContext &context, const QSt
 	static QMutex logMutex;
 	QMutexLocker lock(&logMutex);
 
+	static Counter &lines = Metrics::instance().counter("volumecontroller_log_lines_total", "Log messages");
+	static Counter &dropped = Metrics::instance().counter("volumecontroller_log_lines_dropped_total", "Log messages that could not be written to the log file");
+	lines.add();
+
 	defaultMessageHandler(type, context, msg);
 
 	if(logFile.isOpen()) {
-		logFile.write(qFormatLogMessage(type, context, msg).toUtf8() + '\n');
+		if(logFile.write(qFormatLogMessage(type, context, msg).toUtf8() + '\n') < 0)
+			dropped.add();
 		logFile.flush();
 	}
 }
@@ -44,11 +54,33 @@ void enableLogToFile() {
 	logFile.open(QIODevice::Append | QIODevice::Text);
 }
 
+// Hands the command line to the running instance without loading widgets or the audio stack
+int forwardToRunningInstance(int argc, char *argv[]) {
+	QElapsedTimer timer;
+	timer.start();
+
+	QStringList command;
+	for(int i = 1; i < argc; ++i)
+		command << QString::fromLocal8Bit(argv[i]);
+	if(command.isEmpty())
+		command << "show";
+
+	const auto reply = CommandChannel::forward(command, forwardTimeout);
+	qInfo() << "Forwarded" << command << "in" << timer.nsecsElapsed() / 1000000.0 << "ms";
+	if(!reply)
+		return 1;
+	if(!reply->isEmpty()) {
+		qWarning() << *reply;
+		return 2;
+	}
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	RunGuard guard("volumecontroller");
 	if(!guard.tryToRun())
-		return 0;
+		return forwardToRunningInstance(argc, argv);
 
 	QByteArray envVar = qgetenv("QTDIR");       //  check if the app is ran in Qt Creator
 
@@ -67,6 +99,11 @@ int main(int argc, char *argv[])
 
 
 
+	QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
+	QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	QApplication::setHighDpiScaleFactorRoundingPolicy(Qt::HighDpiScaleFactorRoundingPolicy::PassThrough);
+#endif
 	QApplication a(argc, argv);
 	QApplication::setFont(QFont("Segoe UI"));
 
@@ -95,5 +132,11 @@ int main(int argc, char *argv[])
 	});
 //	w.fadeIn();
 
+	CommandServer commandServer([&w](const QStringList &command) { return w.runCommand(command); });
+	commandServer.listen();
+
+	MetricsServer metricsServer;
+	metricsServer.listen();
+
 	return a.exec();
 }
@@ -0,0 +1,124 @@
+#include "memoryaccounting.h"
+#include "metrics.h"
+
+#include <Windows.h>
+#include <Psapi.h>
+
+#include <QDebug>
+
+#include <array>
+#include <atomic>
+
+namespace {
+
+struct Counters {
+	std::atomic<qint64> bytes{0};
+	std::atomic<qint64> objects{0};
+};
+
+std::array<Counters, size_t(MemoryCategory::Count)> &Categories() {
+	static std::array<Counters, size_t(MemoryCategory::Count)> categories;
+	static const bool registered = []() {
+		for(int i = 0; i < int(MemoryCategory::Count); ++i) {
+			const auto category = MemoryCategory(i);
+			const QByteArray labels = QByteArray("category=\"") + ToString(category) + '"';
+			Metrics::instance().addGauge("volumecontroller_accounted_memory_bytes", "Memory accounted to a subsystem", labels.constData(), nullptr, [category]() {
+				return qreal(MemoryAccounting::usage(category).bytes);
+			});
+		}
+		return true;
+	}();
+	Q_UNUSED(registered);
+	return categories;
+}
+
+}
+
+const char *ToString(MemoryCategory category) {
+	switch(category) {
+	case MemoryCategory::Icons:
+		return "icons";
+	case MemoryCategory::Widgets:
+		return "widgets";
+	case MemoryCategory::Sessions:
+		return "sessions";
+	case MemoryCategory::LayoutRows:
+		return "layout_rows";
+	case MemoryCategory::Count:
+		break;
+	}
+	return "unknown";
+}
+
+namespace MemoryAccounting {
+
+void add(MemoryCategory category, qint64 bytes, qint64 objects) {
+	auto &counters = Categories()[size_t(category)];
+	counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	counters.objects.fetch_add(objects, std::memory_order_relaxed);
+}
+
+void remove(MemoryCategory category, qint64 bytes, qint64 objects) {
+	add(category, -bytes, -objects);
+}
+
+Usage usage(MemoryCategory category) {
+	const auto &counters = Categories()[size_t(category)];
+	return Usage{counters.bytes.load(std::memory_order_relaxed), counters.objects.load(std::memory_order_relaxed)};
+}
+
+QString report() {
+	QString text;
+	qint64 total = 0;
+	for(int i = 0; i < int(MemoryCategory::Count); ++i) {
+		const auto category = MemoryCategory(i);
+		const auto u = usage(category);
+		total += u.bytes;
+		text += QString("%1 %2 KiB in %3 objects\n").arg(QLatin1String(ToString(category)), -12).arg(u.bytes / 1024, 8).arg(u.objects);
+	}
+	text += QString("%1 %2 KiB\n").arg(QLatin1String("accounted"), -12).arg(total / 1024, 8);
+
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		text += QString("%1 %2 KiB\n").arg(QLatin1String("working set"), -12).arg(qint64(counters.WorkingSetSize) / 1024, 8);
+	return text;
+}
+
+void logReport() {
+	qInfo().noquote() << "Memory report:\n" + report();
+}
+
+}
+
+MemoryAccount::MemoryAccount(MemoryCategory category, qint64 bytes, qint64 objects)
+	: category(category), _bytes(bytes), objects(objects) {
+	MemoryAccounting::add(category, _bytes, objects);
+}
+
+MemoryAccount::~MemoryAccount() {
+	MemoryAccounting::remove(category, _bytes, objects);
+}
+
+MemoryAccount::MemoryAccount(MemoryAccount &&other) noexcept
+	: category(other.category), _bytes(other._bytes), objects(other.objects) {
+	other._bytes = 0;
+	other.objects = 0;
+}
+
+MemoryAccount &MemoryAccount::operator=(MemoryAccount &&other) noexcept {
+	if(this == &other)
+		return *this;
+	MemoryAccounting::remove(category, _bytes, objects);
+	category = other.category;
+	_bytes = other._bytes;
+	objects = other.objects;
+	other._bytes = 0;
+	other.objects = 0;
+	return *this;
+}
+
+void MemoryAccount::resize(qint64 bytes, qint64 objects) {
+	MemoryAccounting::add(category, bytes - _bytes, objects - this->objects);
+	_bytes = bytes;
+	this->objects = objects;
+}
@@ -0,0 +1,55 @@
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <QString>
+
+enum class MemoryCategory {
+	Icons,
+	Widgets,
+	Sessions,
+	LayoutRows,
+	Count
+};
+
+const char *ToString(MemoryCategory category);
+
+// Live bytes and objects per category, lock free. Byte counts are estimates of what the owner holds directly,
+// memory hidden behind private Qt or COM implementations is not visible.
+namespace MemoryAccounting {
+	struct Usage {
+		qint64 bytes = 0;
+		qint64 objects = 0;
+	};
+
+	void add(MemoryCategory category, qint64 bytes, qint64 objects = 1);
+	void remove(MemoryCategory category, qint64 bytes, qint64 objects = 1);
+
+	Usage usage(MemoryCategory category);
+
+	// Breakdown per category next to the working set of the process
+	QString report();
+	void logReport();
+}
+
+// Accounts bytes to a category for its own lifetime
+class MemoryAccount {
+public:
+	MemoryAccount(MemoryCategory category, qint64 bytes = 0, qint64 objects = 1);
+	~MemoryAccount();
+
+	MemoryAccount(MemoryAccount &&other) noexcept;
+	MemoryAccount &operator=(MemoryAccount &&other) noexcept;
+	MemoryAccount(const MemoryAccount &) = delete;
+	MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+	void resize(qint64 bytes, qint64 objects);
+
+	qint64 bytes() const noexcept { return _bytes; }
+
+private:
+	MemoryCategory category;
+	qint64 _bytes;
+	qint64 objects;
+};
+
+#endif // MEMORYACCOUNTING_H
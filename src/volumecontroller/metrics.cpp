@@ -0,0 +1,203 @@
+#include "metrics.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <Psapi.h>
+#endif
+
+Metrics &Metrics::instance() {
+	static Metrics metrics;
+	return metrics;
+}
+
+Metrics::Metrics() {
+#ifdef Q_OS_WIN
+	addGauge("volumecontroller_resident_memory_bytes", "Working set of the process", "", nullptr, []() {
+		PROCESS_MEMORY_COUNTERS counters;
+		if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return qreal(0);
+		return qreal(counters.WorkingSetSize);
+	});
+#endif
+}
+
+Metrics::Entry &Metrics::add(const char *name, const char *help, const char *labels, Type type) {
+	auto &entry = entries.emplace_back();
+	entry.name = name;
+	entry.help = help;
+	entry.labels = labels;
+	entry.type = type;
+	return entry;
+}
+
+Metrics::Entry *Metrics::find(const char *name, const char *labels, Type type) {
+	const auto it = std::find_if(entries.begin(), entries.end(), [&](const Entry &entry) {
+		return entry.type == type && entry.name == name && entry.labels == labels;
+	});
+	return it != entries.end() ? &*it : nullptr;
+}
+
+Counter &Metrics::counter(const char *name, const char *help, const char *labels) {
+	QMutexLocker lock(&mutex);
+	if(auto entry = find(name, labels, Type::Counter)) {
+		if(entry->help.isEmpty())
+			entry->help = help;
+		return *entry->counter;
+	}
+	auto &counter = counters.emplace_back();
+	add(name, help, labels, Type::Counter).counter = &counter;
+	return counter;
+}
+
+LatencyHistogram &Metrics::histogram(const char *name, const char *help, const char *labels) {
+	QMutexLocker lock(&mutex);
+	auto entry = find(name, labels, Type::Histogram);
+	if(entry && entry->ownedHistogram) {
+		if(entry->help.isEmpty())
+			entry->help = help;
+		return *entry->ownedHistogram;
+	}
+	auto &histogram = histograms.emplace_back();
+	auto &added = add(name, help, labels, Type::Histogram);
+	added.histogram = &histogram;
+	added.ownedHistogram = &histogram;
+	return histogram;
+}
+
+void Metrics::addHistogram(const char *name, const char *help, const char *labels, const LatencyHistogram &histogram) {
+	QMutexLocker lock(&mutex);
+	add(name, help, labels, Type::Histogram).histogram = &histogram;
+}
+
+void Metrics::addGauge(const char *name, const char *help, const char *labels, QObject *context, std::function<qreal()> value) {
+	QMutexLocker lock(&mutex);
+	auto &entry = add(name, help, labels, Type::Gauge);
+	entry.hasContext = context != nullptr;
+	entry.context = context;
+	entry.gauge = std::move(value);
+}
+
+static const char *ToString(int type) {
+	static const char *names[] = {"counter", "gauge", "histogram"};
+	return names[type];
+}
+
+static QByteArray Labels(const QByteArray &labels, const QByteArray &extra = {}) {
+	if(labels.isEmpty() && extra.isEmpty())
+		return {};
+	if(labels.isEmpty() || extra.isEmpty())
+		return '{' + labels + extra + '}';
+	return '{' + labels + ',' + extra + '}';
+}
+
+// Backslashes and line feeds in help texts, additionally double quotes in label values
+static QByteArray Escape(const QByteArray &text, bool quotes) {
+	QByteArray escaped;
+	escaped.reserve(text.size());
+	for(const char c : text) {
+		if(c == '\\' || (quotes && c == '"'))
+			escaped += '\\';
+		if(c == '\n')
+			escaped += "\\n";
+		else
+			escaped += c;
+	}
+	return escaped;
+}
+
+QByteArray Metrics::label(const char *name, const QString &value) {
+	return name + QByteArray("=\"") + Escape(value.toUtf8(), true) + '"';
+}
+
+QByteArray Metrics::exposition() const {
+	QMutexLocker lock(&mutex);
+	// families have to be contiguous
+	std::vector<const Entry*> sorted;
+	for(const auto &entry : entries) {
+		if(!entry.hasContext || entry.context)
+			sorted.push_back(&entry);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+		return a->name < b->name;
+	});
+
+	QByteArray out;
+	const QByteArray *family = nullptr;
+	for(const Entry *entry : sorted) {
+		if(!family || *family != entry->name) {
+			family = &entry->name;
+			out += "# HELP " + entry->name + ' ' + Escape(entry->help, false) + '\n';
+			out += "# TYPE " + entry->name + ' ' + ToString(int(entry->type)) + '\n';
+		}
+
+		switch(entry->type) {
+		case Type::Counter:
+			out += entry->name + Labels(entry->labels) + ' ' + QByteArray::number(entry->counter->value()) + '\n';
+			break;
+		case Type::Gauge:
+			out += entry->name + Labels(entry->labels) + ' ' + QByteArray::number(entry->gauge(), 'g', 15) + '\n';
+			break;
+		case Type::Histogram: {
+			const auto &histogram = *entry->histogram;
+			quint64 cumulative = 0;
+			for(int i = 0; i < LatencyHistogram::bucketCount - 1; ++i) {
+				cumulative += histogram.bucket(i);
+				const QByteArray le = "le=\"" + QByteArray::number(LatencyHistogram::bucketUpperBoundUs(i) / 1e6, 'g', 6) + '"';
+				out += entry->name + "_bucket" + Labels(entry->labels, le) + ' ' + QByteArray::number(cumulative) + '\n';
+			}
+			cumulative += histogram.bucket(LatencyHistogram::bucketCount - 1);
+			out += entry->name + "_bucket" + Labels(entry->labels, "le=\"+Inf\"") + ' ' + QByteArray::number(cumulative) + '\n';
+			out += entry->name + "_sum" + Labels(entry->labels) + ' ' + QByteArray::number(histogram.sumUs() / 1e6, 'g', 15) + '\n';
+			out += entry->name + "_count" + Labels(entry->labels) + ' ' + QByteArray::number(cumulative) + '\n';
+			break;
+		}
+		}
+	}
+	return out;
+}
+
+Counter &CacheRequests(const char *labels) {
+	return Metrics::instance().counter("volumecontroller_cache_requests_total", "Cache lookups by result", labels);
+}
+
+QString MetricsServer::serverName() {
+	return "volumecontroller-metrics-" + qEnvironmentVariable("USERNAME");
+}
+
+MetricsServer::MetricsServer(QObject *parent) : QObject(parent) {
+	server.setSocketOptions(QLocalServer::UserAccessOption);
+	connect(&server, &QLocalServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+bool MetricsServer::listen() {
+	const QString name = serverName();
+	// a crashed instance may have left the name behind
+	QLocalServer::removeServer(name);
+	if(!server.listen(name)) {
+		qWarning() << "Could not listen for metrics scrapes on" << name << ":" << server.errorString();
+		return false;
+	}
+	qDebug() << "Serving metrics on" << server.fullServerName();
+	return true;
+}
+
+void MetricsServer::onNewConnection() {
+	while(QLocalSocket *socket = server.nextPendingConnection()) {
+		QElapsedTimer timer;
+		timer.start();
+		const QByteArray text = Metrics::instance().exposition();
+		connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+		connect(socket, &QLocalSocket::bytesWritten, socket, [socket]() {
+			if(socket->bytesToWrite() == 0)
+				socket->disconnectFromServer();
+		});
+		socket->write(text);
+		qDebug() << "Served" << text.size() << "bytes of metrics in" << timer.nsecsElapsed() / 1000 << "us";
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "volumecontroller/audio/backendtrace.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QMutex>
+#include <QPointer>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Counters and histograms are lock free, only registering takes a lock.
+// Hot paths look their metrics up once and keep the reference, it stays valid until exit.
+class Counter {
+public:
+	void add(quint64 value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+	quint64 value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<quint64> _value{0};
+};
+
+// Records the time until the end of the scope
+class ScopedLatency {
+public:
+	Q_DISABLE_COPY_MOVE(ScopedLatency);
+
+	explicit ScopedLatency(LatencyHistogram &histogram) : histogram(histogram) { timer.start(); }
+	~ScopedLatency() { histogram.record(timer.nsecsElapsed() / 1000); }
+
+private:
+	LatencyHistogram &histogram;
+	QElapsedTimer timer;
+};
+
+class Metrics {
+public:
+	static Metrics &instance();
+
+	// labels are in exposition syntax without braces, like method="GetPeakValue".
+	// Asking again for the same name and labels returns the same metric, an empty help is filled in later.
+	Counter &counter(const char *name, const char *help, const char *labels = "");
+	// Microsecond histogram, exported in seconds
+	LatencyHistogram &histogram(const char *name, const char *help, const char *labels = "");
+	// Exports a histogram owned by someone else, it has to live until exit
+	void addHistogram(const char *name, const char *help, const char *labels, const LatencyHistogram &histogram);
+	// Evaluated on every scrape on the GUI thread, skipped once a given context is destroyed
+	void addGauge(const char *name, const char *help, const char *labels, QObject *context, std::function<qreal()> value);
+
+	// Prometheus text format 0.0.4
+	QByteArray exposition() const;
+
+	// name="value" with the value escaped, for labels built from runtime values
+	static QByteArray label(const char *name, const QString &value);
+
+private:
+	Metrics();
+
+	enum class Type { Counter, Gauge, Histogram };
+
+	struct Entry {
+		QByteArray name;
+		QByteArray help;
+		QByteArray labels;
+		Type type;
+		Counter *counter = nullptr;
+		const LatencyHistogram *histogram = nullptr;
+		// set for histograms created by the registry
+		LatencyHistogram *ownedHistogram = nullptr;
+		bool hasContext = false;
+		QPointer<QObject> context;
+		std::function<qreal()> gauge;
+	};
+
+	Entry &add(const char *name, const char *help, const char *labels, Type type);
+	Entry *find(const char *name, const char *labels, Type type);
+
+	mutable QMutex mutex;
+	std::vector<Entry> entries;
+	// stable addresses for the references handed out
+	std::deque<Counter> counters;
+	std::deque<LatencyHistogram> histograms;
+};
+
+// Requests to a cache, labeled with cache and result="hit" or result="miss"
+Counter &CacheRequests(const char *labels);
+
+// Serves Metrics::exposition() to every client connecting to the local socket, then closes the connection
+class MetricsServer : public QObject {
+	Q_OBJECT
+
+public:
+	static QString serverName();
+
+	MetricsServer(QObject *parent = nullptr);
+
+	bool listen();
+
+private:
+	void onNewConnection();
+
+	QLocalServer server;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,111 @@
+#ifndef OBSERVERLIST_H
+#define OBSERVERLIST_H
+
+#include <QtGlobal>
+
+#include <functional>
+
+// Intrusive list of observers, subscribing and notifying never allocate. Not thread safe, a list and its
+// observers are only used on one thread. Observers unsubscribe when destroyed, also from within notify;
+// a callback destroying its own observer must not touch its captures afterwards.
+template<typename... Args>
+class ObserverList {
+public:
+	class Observer {
+	public:
+		Q_DISABLE_COPY_MOVE(Observer);
+
+		Observer() = default;
+		explicit Observer(std::function<void(Args...)> callback) : callback(std::move(callback)) {}
+		~Observer() { unsubscribe(); }
+
+		void setCallback(std::function<void(Args...)> value) { callback = std::move(value); }
+
+		// Moves the observer to the end of list
+		void subscribe(ObserverList &list) { list.add(*this); }
+		void unsubscribe() {
+			if(_list)
+				_list->remove(*this);
+		}
+
+		bool subscribed() const { return _list != nullptr; }
+
+	private:
+		friend class ObserverList;
+
+		std::function<void(Args...)> callback;
+		ObserverList *_list = nullptr;
+		Observer *previous = nullptr;
+		Observer *next = nullptr;
+	};
+
+	Q_DISABLE_COPY_MOVE(ObserverList);
+
+	ObserverList() = default;
+	~ObserverList() {
+		while(first)
+			remove(*first);
+	}
+
+	// Observers subscribed by a callback are called in the same pass, the list must outlive the call
+	void notify(Args... args) {
+		Q_ASSERT(!notifying);
+		notifying = true;
+		for(Observer *observer = first; observer;) {
+			current = observer;
+			cursor = observer->next;
+			if(observer->callback)
+				observer->callback(args...);
+			observer = current ? current->next : cursor;
+		}
+		current = nullptr;
+		cursor = nullptr;
+		notifying = false;
+	}
+
+	bool empty() const { return first == nullptr; }
+
+private:
+	void add(Observer &observer) {
+		observer.unsubscribe();
+		observer._list = this;
+		observer.previous = last;
+		observer.next = nullptr;
+		if(last)
+			last->next = &observer;
+		else
+			first = &observer;
+		last = &observer;
+		// the observer being called unsubscribed and was the last one
+		if(notifying && !current && !cursor)
+			cursor = &observer;
+	}
+
+	void remove(Observer &observer) {
+		Q_ASSERT(observer._list == this);
+		if(current == &observer)
+			current = nullptr;
+		if(cursor == &observer)
+			cursor = observer.next;
+		if(observer.previous)
+			observer.previous->next = observer.next;
+		else
+			first = observer.next;
+		if(observer.next)
+			observer.next->previous = observer.previous;
+		else
+			last = observer.previous;
+		observer._list = nullptr;
+		observer.previous = nullptr;
+		observer.next = nullptr;
+	}
+
+	Observer *first = nullptr;
+	Observer *last = nullptr;
+	// observer being called and its successor at the time, while notifying
+	Observer *current = nullptr;
+	Observer *cursor = nullptr;
+	bool notifying = false;
+};
+
+#endif // OBSERVERLIST_H
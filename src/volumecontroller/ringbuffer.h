@@ -0,0 +1,38 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <array>
+#include <cstddef>
+
+// Keeps the last Capacity values, pushing never allocates
+template<typename T, size_t Capacity>
+class RingBuffer {
+public:
+	void push(const T &value) {
+		values[(first + count) % Capacity] = value;
+		if(count < Capacity)
+			++count;
+		else
+			first = (first + 1) % Capacity;
+	}
+
+	void clear() {
+		first = 0;
+		count = 0;
+	}
+
+	size_t size() const noexcept { return count; }
+	bool empty() const noexcept { return count == 0; }
+	static constexpr size_t capacity() noexcept { return Capacity; }
+
+	// index 0 is the oldest value
+	const T &operator[](size_t index) const { return values[(first + index) % Capacity]; }
+	const T &back() const { return (*this)[count - 1]; }
+
+private:
+	std::array<T, Capacity> values{};
+	size_t first = 0;
+	size_t count = 0;
+};
+
+#endif // RINGBUFFER_H
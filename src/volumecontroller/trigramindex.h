@@ -0,0 +1,87 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QString>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Case insensitive substring search over the texts of ids, kept up to date one id at a time.
+// Queries of three and more characters only look at the ids sharing their rarest trigram.
+template<typename Id, typename Hash = std::hash<Id>>
+class TrigramIndex {
+public:
+	using Result = std::unordered_set<Id, Hash>;
+
+	// Replaces the text of id if it is already indexed
+	void insert(const Id &id, const QString &text) {
+		remove(id);
+		const QString folded = text.toCaseFolded();
+		for(const Trigram trigram : trigrams(folded))
+			postings[trigram].insert(id);
+		texts.emplace(id, folded);
+	}
+
+	void remove(const Id &id) {
+		const auto it = texts.find(id);
+		if(it == texts.end())
+			return;
+		for(const Trigram trigram : trigrams(it->second)) {
+			const auto posting = postings.find(trigram);
+			posting->second.erase(id);
+			if(posting->second.empty())
+				postings.erase(posting);
+		}
+		texts.erase(it);
+	}
+
+	// Ids whose text contains query
+	Result find(const QString &query) const {
+		const QString folded = query.toCaseFolded();
+		Result result;
+		const auto test = [&](const Id &id, const QString &text) {
+			if(text.contains(folded))
+				result.insert(id);
+		};
+
+		if(folded.size() < 3) {
+			for(const auto &[id, text] : texts)
+				test(id, text);
+			return result;
+		}
+
+		const Result *rarest = nullptr;
+		for(const Trigram trigram : trigrams(folded)) {
+			const auto posting = postings.find(trigram);
+			if(posting == postings.end())
+				return result;
+			if(!rarest || posting->second.size() < rarest->size())
+				rarest = &posting->second;
+		}
+		for(const Id &id : *rarest)
+			test(id, texts.at(id));
+		return result;
+	}
+
+	size_t size() const noexcept { return texts.size(); }
+
+private:
+	using Trigram = quint64;
+
+	static std::vector<Trigram> trigrams(const QString &folded) {
+		std::vector<Trigram> result;
+		for(int i = 0; i + 2 < folded.size(); ++i) {
+			result.push_back(Trigram(folded[i].unicode()) << 32 | Trigram(folded[i + 1].unicode()) << 16 | Trigram(folded[i + 2].unicode()));
+		}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+		return result;
+	}
+
+	std::unordered_map<Id, QString, Hash> texts;
+	std::unordered_map<Trigram, Result> postings;
+};
+
+#endif // TRIGRAMINDEX_H
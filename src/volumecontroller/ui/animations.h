@@ -94,6 +94,9 @@ public:
 
 	QWidget * target() noexcept { return target_; }
 
+	const QPropertyAnimation &inAnimation() const noexcept { return in_; }
+	const QPropertyAnimation &outAnimation() const noexcept { return out_; }
+
 	bool isRunning() const noexcept {
 		return currentAnimation_ && isCurrentRunning();
 	}
@@ -1,15 +1,21 @@
 #include "devicevolumecontroller.h"
+#include "volumecontroller/audio/backendtrace.h"
+#include "volumecontroller/metrics.h"
 
-#include <QTimer>
 #include <QDebug>
 
-constexpr QSize deviceVolumeIconSize = QSize(32, 32);
-
-DeviceVolumeController::DeviceVolumeController(QWidget *parent, AudioDeviceManager &&m, const DeviceVolumeControllerTheme &theme, bool showInactive)
+DeviceVolumeController::DeviceVolumeController(QWidget *parent, AudioEndpoint &&endpoint, VolumeProfiles &profiles, const DeviceVolumeControllerTheme &theme, bool showInactive, bool lazySessions,
+										  const SessionSnapshot *snapshot)
 	: QWidget(parent),
-	  manager(std::move(m)),
+	  manager(std::move(endpoint.manager)),
+	  sessionGroups(std::move(endpoint.sessionGroups)),
+	  _deviceControl(std::move(endpoint.control)),
 	  gridLayout(this),
-	  volumeIcons(deviceVolumeIconSize, theme.icon())
+	  iconTheme(&theme.icon()),
+	  devicePixelRatio(devicePixelRatioF()),
+	  volumeIcons(ThemeResources::instance().volumeIcons(*iconTheme, deviceVolumeIconSize, devicePixelRatio)),
+	  _deviceName(std::move(endpoint.name)),
+	  _deviceId(std::move(endpoint.id))
 {
 	setObjectName(QString::fromUtf8("DeviceVolumeController"));
 	QSizePolicy sizePolicy1(QSizePolicy::Preferred, QSizePolicy::Preferred);
@@ -27,19 +33,8 @@ DeviceVolumeController::DeviceVolumeController(QWidget *parent, AudioDeviceManag
 	gridLayout.setContentsMargins(12, 12, 12, 12);
 	gridLayout.setAlignment(Qt::AlignTop);
 
-	qDebug() << "Creating device control.";
-	auto deviceControlPtr = manager.createDeviceControl();
-	Q_ASSERT(deviceControlPtr);
-	_deviceControl = std::move(deviceControlPtr);
-
-	qDebug() << "Creating session groups.";
-	auto optSessionGroups = manager.createSessionGroups();
-	Q_ASSERT(optSessionGroups.has_value());
-	sessionGroups = std::move(*optSessionGroups);
-
-	_deviceName = manager.device().name().value_or("Lautsprecher");
-
-	qDebug() << "Creating device item.";
+	Q_ASSERT(_deviceControl);
+	qDebug() << "Creating device item for" << _deviceName;
 	createDeviceItem(theme.volumeItem());
 	VolumeControlList::addItem(gridLayout, *deviceItem, 0);
 
@@ -47,26 +42,36 @@ DeviceVolumeController::DeviceVolumeController(QWidget *parent, AudioDeviceManag
 	gridLayout.addWidget(separator, 1, 0, 1, 3);
 
 	qDebug() << "Creating VolumeControlList.";
-	_controlList = new VolumeControlList(this, this->sessionGroups, theme.volumeItem(), showInactive);
+	_controlList = new VolumeControlList(this, this->sessionGroups, profiles, theme.volumeItem(), showInactive, lazySessions,
+													 Metrics::label("device", _deviceId), snapshot);
 	gridLayout.addWidget(_controlList, 2, 0, 1, 3);
-
-	qDebug() << "Starting peak update timer.";
-	QTimer *timer = new QTimer(this);
-	connect(timer, &QTimer::timeout, [this]() {
-		controlList().updatePeaks();
-		deviceItem->updatePeak();
-	});
-	timer->start(15);
+	connect(_controlList, &VolumeControlList::contentChanged, this, &DeviceVolumeController::contentChanged);
 
 	qDebug() << "Start listening on audio session notifications.";
-	audioSessionNotification = ComPtr<AudioSessionNotification>(new AudioSessionNotification(this));
+	// no parent, the backend may still hold it after this section is gone
+	audioSessionNotification = ComPtr<AudioSessionNotification>(new AudioSessionNotification(nullptr, &profiles));
 	connect(audioSessionNotification.get(), &AudioSessionNotification::sessionCreated,
 			  this, &DeviceVolumeController::addSession, Qt::ConnectionType::QueuedConnection);
-	manager.manager().RegisterSessionNotification(audioSessionNotification.get());
+	// runs before the unregistration the destructor posts, which keeps both alive until then
+	AudioThread::instance().post([sessionManager = &manager.manager(), notification = audioSessionNotification.get()]() {
+		BACKEND_CALL(RegisterNotification, "device section created", sessionManager->RegisterSessionNotification(notification));
+	});
 }
 
 DeviceVolumeController::~DeviceVolumeController() {
-	manager.manager().UnregisterSessionNotification(audioSessionNotification.get());
+	audioSessionNotification->detach();
+	AudioThread::instance().post([device = std::make_shared<AudioDeviceManager>(std::move(manager)),
+										  notification = std::shared_ptr<AudioSessionNotification>(std::move(audioSessionNotification))]() {
+		BACKEND_CALL(UnregisterNotification, "device section destroyed", device->manager().UnregisterSessionNotification(notification.get()));
+	});
+	// the list and its executable groups refer to the sessions, which are gone before the child widgets
+	delete _controlList;
+	_controlList = nullptr;
+}
+
+const ProgrammInformation *DeviceVolumeController::programInformation(DWORD pid) {
+	const auto it = sessionGroups.findPidGroup(pid);
+	return it == sessionGroups.groups().end() ? nullptr : (*it)->infoPtr();
 }
 
 void DeviceVolumeController::resizeEvent(QResizeEvent *) {
@@ -74,12 +79,26 @@ void DeviceVolumeController::resizeEvent(QResizeEvent *) {
 	parentWidget()->adjustSize();
 }
 
+void DeviceVolumeController::updatePeaks(qreal dt) {
+	controlList().updatePeaks(dt);
+	deviceItem->updatePeak(dt);
+}
+
 void DeviceVolumeController::changeTheme(const DeviceVolumeControllerTheme &theme) {
-	volumeIcons = VolumeIcons(deviceVolumeIconSize, theme.icon());
-	deviceItem->updateThemeAndIcon(theme.volumeItem());
+	iconTheme = &theme.icon();
+	volumeIcons = ThemeResources::instance().volumeIcons(*iconTheme, deviceVolumeIconSize, devicePixelRatio);
+	deviceItem->updateThemeAndIcon(theme.volumeItem(), *volumeIcons);
 	controlList().changeTheme(theme.volumeItem());
 }
 
+void DeviceVolumeController::setDevicePixelRatio(qreal value) {
+	if(qFuzzyCompare(devicePixelRatio, value))
+		return;
+	devicePixelRatio = value;
+	volumeIcons = ThemeResources::instance().volumeIcons(*iconTheme, deviceVolumeIconSize, devicePixelRatio);
+	deviceItem->setIcons(*volumeIcons);
+}
+
 void DeviceVolumeController::addSession(AudioSession *sessionPtr) {
 	controlList().addSession(std::unique_ptr<AudioSession>(sessionPtr));
 }
@@ -89,8 +108,12 @@ static const QIcon &GetVolumeIcon(const VolumeIcons &volumeIcons, const IAudioCo
 }
 
 void DeviceVolumeController::createDeviceItem(const VolumeItemTheme &theme) {
-	deviceItem = std::make_unique<DeviceVolumeItem>(this, deviceControl(), volumeIcons, deviceName(), theme);
-	connect(&deviceControl(), &DeviceAudioControl::volumeChanged, deviceItem.get(), &DeviceVolumeItem::setVolumeFAndMute, Qt::ConnectionType::QueuedConnection);
+	deviceItem = std::make_unique<DeviceVolumeItem>(this, deviceControl(), *volumeIcons, deviceName(), theme);
+	deviceVolumeObserver.setCallback([this](float volume, bool muted) {
+		deviceItem->setVolumeFAndMute(volume, muted);
+		emit contentChanged();
+	});
+	deviceVolumeObserver.subscribe(deviceControl().volumeObservers());
 }
 
 void DeviceVolumeController::createLineSeperator() {
@@ -5,15 +5,21 @@
 #include <QGridLayout>
 #include "volumecontroller/ui/volumecontrollist.h"
 #include "volumecontroller/audio/audiodevicemanager.h"
+#include "volumecontroller/audio/volumeprofiles.h"
 #include "volumecontroller/ui/volumeicons.h"
+#include "volumecontroller/ui/themeresources.h"
 #include "volumecontroller/ui/theme.h"
 
+constexpr QSize deviceVolumeIconSize = QSize(32, 32);
+
 class DeviceVolumeController : public QWidget
 {
 	Q_OBJECT
 
 public:
-	DeviceVolumeController(QWidget *parent, AudioDeviceManager &&m, const DeviceVolumeControllerTheme &theme, bool showInactive);
+	// One section of the window, showing an endpoint opened with OpenEndpoints()
+	DeviceVolumeController(QWidget *parent, AudioEndpoint &&endpoint, VolumeProfiles &profiles, const DeviceVolumeControllerTheme &theme, bool showInactive, bool lazySessions,
+										  const SessionSnapshot *snapshot);
 	~DeviceVolumeController();
 
 	DeviceAudioControl &deviceControl() { return *_deviceControl; }
@@ -30,8 +36,19 @@ public:
 	AudioDeviceManager &deviceManager() { return manager; }
 
 	const QString &deviceName() const { return _deviceName; }
+	const QString &deviceId() const { return _deviceId; }
+
+	// Resolved program of a process with sessions on this device, nullptr if there is none yet
+	const ProgrammInformation *programInformation(DWORD pid);
 
 	void changeTheme(const DeviceVolumeControllerTheme &theme);
+	void setDevicePixelRatio(qreal value);
+
+	// Reads the values of the last AudioThread::pollPeaks()
+	void updatePeaks(qreal dt);
+
+signals:
+	void contentChanged();
 
 private:
 	void addSession(AudioSession* session);
@@ -46,12 +63,16 @@ private:
 
 	std::unique_ptr<DeviceAudioControl> _deviceControl;
 	std::unique_ptr<DeviceVolumeItem> deviceItem;
+	DeviceAudioControl::VolumeObservers::Observer deviceVolumeObserver;
 
 	QGridLayout gridLayout;
 	QFrame *separator = nullptr;
 
-	VolumeIcons volumeIcons;
+	const IconTheme *iconTheme;
+	qreal devicePixelRatio;
+	std::shared_ptr<const VolumeIcons> volumeIcons;
 	QString _deviceName;
+	QString _deviceId;
 };
 
 #endif // DEVICEVOLUMECONTROLLER_H
@@ -0,0 +1,139 @@
+#include "framescheduler.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+#include <QDebug>
+
+#include "volumecontroller/metrics.h"
+
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(QObject *parent) : QObject(parent) {
+	timer.setTimerType(Qt::PreciseTimer);
+	timer.setSingleShot(true);
+	connect(&timer, &QTimer::timeout, this, &FrameScheduler::tick);
+
+	connect(&animationDriver, &QAnimationDriver::started, this, &FrameScheduler::onAnimationsStarted);
+	connect(&animationDriver, &QAnimationDriver::stopped, this, &FrameScheduler::onAnimationsStopped);
+	animationDriver.install();
+
+	connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this, &FrameScheduler::setScreen);
+	setScreen(QGuiApplication::primaryScreen());
+
+	clock.start();
+}
+
+FrameScheduler::~FrameScheduler() {
+	animationDriver.uninstall();
+}
+
+void FrameScheduler::setMetersActive(bool value) {
+	if(_metersActive == value)
+		return;
+	_metersActive = value;
+	updateRunning();
+}
+
+void FrameStatistics::addFrame(qint64 intervalUs, qint64 workUs, qint64 budgetUs) {
+	if(intervalUs >= 0) {
+		totalIntervalUs += intervalUs;
+		maxIntervalUs = std::max(maxIntervalUs, intervalUs);
+		if(intervalUs > budgetUs + budgetUs / 2)
+			++lateFrames;
+	}
+	++frames;
+	totalWorkUs += workUs;
+	maxWorkUs = std::max(maxWorkUs, workUs);
+}
+
+QDebug operator<<(QDebug debug, const FrameStatistics &statistics) {
+	QDebugStateSaver saver(debug);
+	debug.nospace() << statistics.frames << " frames, interval avg " << statistics.averageIntervalMs() << " ms max "
+						 << statistics.maxIntervalUs / 1000.0 << " ms, " << statistics.lateFrames << " late, work avg "
+						 << statistics.averageWorkMs() << " ms max " << statistics.maxWorkUs / 1000.0 << " ms";
+	return debug;
+}
+
+void FrameScheduler::tick() {
+	const qint64 now = clock.nsecsElapsed() / 1000;
+	const qint64 interval = lastFrameUs >= 0 ? now - lastFrameUs : -1;
+	const qreal dt = interval >= 0 ? interval / 1000000.0 : 0.0;
+	lastFrameUs = now;
+
+	const bool animating = animationDriver.isRunning();
+	if(_metersActive)
+		emit frame(dt);
+	if(animating)
+		animationDriver.advance();
+
+	const qint64 work = clock.nsecsElapsed() / 1000 - now;
+	_statistics.addFrame(interval, work, intervalUs);
+	static LatencyHistogram &frameWork = Metrics::instance().histogram("volumecontroller_frame_work_seconds", "Work done per scheduled frame, meters and animations");
+	frameWork.record(work);
+	if(animating) {
+		animationStatistics.addFrame(lastAnimationFrameUs >= 0 ? now - lastAnimationFrameUs : -1, work, intervalUs);
+		lastAnimationFrameUs = now;
+	}
+
+	if(running)
+		scheduleNext();
+}
+
+void FrameScheduler::scheduleNext() {
+	const qint64 now = clock.nsecsElapsed() / 1000;
+	nextDeadlineUs += intervalUs;
+	if(nextDeadlineUs <= now)
+		nextDeadlineUs = now + intervalUs - (now - nextDeadlineUs) % intervalUs;
+	timer.start(int((nextDeadlineUs - now + 999) / 1000));
+}
+
+void FrameScheduler::updateRunning() {
+	const bool shouldRun = _metersActive || animationDriver.isRunning();
+	if(shouldRun == running)
+		return;
+	running = shouldRun;
+
+	if(running) {
+		_statistics = {};
+		lastFrameUs = -1;
+		nextDeadlineUs = clock.nsecsElapsed() / 1000;
+		timer.start(0);
+	} else {
+		timer.stop();
+		logStatistics();
+	}
+}
+
+void FrameScheduler::onAnimationsStarted() {
+	animationStatistics = {};
+	lastAnimationFrameUs = -1;
+	updateRunning();
+}
+
+void FrameScheduler::onAnimationsStopped() {
+	if(animationStatistics.frames > 0)
+		qDebug() << "Animation frame statistics" << animationLabel << ":" << animationStatistics;
+	updateRunning();
+}
+
+void FrameScheduler::setScreen(QScreen *screen) {
+	disconnect(refreshRateConnection);
+	if(!screen)
+		return;
+	refreshRateConnection = connect(screen, &QScreen::refreshRateChanged, this, &FrameScheduler::setRefreshRate);
+	setRefreshRate(screen->refreshRate());
+}
+
+void FrameScheduler::setRefreshRate(qreal rate) {
+	if(rate <= 0)
+		rate = 60.0;
+	qDebug() << "Frame scheduler refresh rate is" << rate << "Hz";
+	_refreshRate = rate;
+	intervalUs = qint64(1000000.0 / rate);
+}
+
+void FrameScheduler::logStatistics() const {
+	if(_statistics.frames == 0)
+		return;
+	qDebug() << "Frame statistics at" << _refreshRate << "Hz:" << _statistics;
+}
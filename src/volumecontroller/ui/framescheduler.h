@@ -0,0 +1,90 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QAnimationDriver>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+class QScreen;
+
+struct FrameStatistics {
+	int frames = 0;
+	int lateFrames = 0;
+	qint64 totalIntervalUs = 0;
+	qint64 maxIntervalUs = 0;
+	qint64 totalWorkUs = 0;
+	qint64 maxWorkUs = 0;
+
+	// intervalUs is negative for the first frame after the scheduler started
+	void addFrame(qint64 intervalUs, qint64 workUs, qint64 budgetUs);
+
+	qreal averageIntervalMs() const { return frames > 1 ? totalIntervalUs / 1000.0 / (frames - 1) : 0.0; }
+	qreal averageWorkMs() const { return frames > 0 ? totalWorkUs / 1000.0 / frames : 0.0; }
+};
+
+QDebug operator<<(QDebug debug, const FrameStatistics &statistics);
+
+// Steps Qt's animations from the frame scheduler instead of the unified animation timer
+class FrameAnimationDriver : public QAnimationDriver {
+public:
+	using QAnimationDriver::QAnimationDriver;
+};
+
+class FrameScheduler : public QObject {
+	Q_OBJECT
+
+public:
+	explicit FrameScheduler(QObject *parent = nullptr);
+	~FrameScheduler();
+
+	void setMetersActive(bool value);
+	bool metersActive() const noexcept { return _metersActive; }
+
+	bool isRunning() const noexcept { return running; }
+
+	qreal refreshRate() const noexcept { return _refreshRate; }
+	qint64 frameIntervalUs() const noexcept { return intervalUs; }
+
+	const FrameStatistics &statistics() const noexcept { return _statistics; }
+
+	// Label of the animations started next, animation frames are logged separately under this label
+	void setAnimationLabel(const char *label) { animationLabel = label; }
+
+signals:
+	// dt is the time since the previous frame in seconds, animations are advanced after all receivers ran
+	void frame(qreal dt);
+
+private:
+	void tick();
+	void scheduleNext();
+	void updateRunning();
+	void onAnimationsStarted();
+	void onAnimationsStopped();
+
+	void setScreen(QScreen *screen);
+	void setRefreshRate(qreal rate);
+
+	void logStatistics() const;
+
+	QTimer timer;
+	FrameAnimationDriver animationDriver;
+	QElapsedTimer clock;
+	QMetaObject::Connection refreshRateConnection;
+
+	qreal _refreshRate = 60.0;
+	qint64 intervalUs = 16667;
+	qint64 nextDeadlineUs = 0;
+	qint64 lastFrameUs = -1;
+
+	bool _metersActive = false;
+	bool running = false;
+
+	FrameStatistics _statistics;
+	FrameStatistics animationStatistics;
+	qint64 lastAnimationFrameUs = -1;
+	const char *animationLabel = "window";
+};
+
+#endif // FRAMESCHEDULER_H
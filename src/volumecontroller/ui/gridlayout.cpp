@@ -3,6 +3,7 @@
 #include <QDebug>
 
 #include <volumecontroller/joiner.h>
+#include <volumecontroller/metrics.h>
 
 GridLayout::GridLayout(QWidget *parent) : QLayout(parent) {}
 
@@ -28,6 +29,7 @@ void GridLayout::insertRow(int index) {
 	Q_ASSERT(0 <= index && index < rowCount());
 	const auto it = rows.begin() + index;
 	rows.emplace(it, columnCount());
+	accountRows();
 	invalidate();
 }
 
@@ -36,6 +38,7 @@ void GridLayout::removeRow(int index) {
 	const auto it = rows.begin() + index;
 	clearRow(*it);
 	rows.erase(it);
+	accountRows();
 	invalidate();
 }
 
@@ -48,6 +51,8 @@ void GridLayout::clearRowItems(const int index) {
 
 void GridLayout::clearRows() {
 	rows.clear();
+	itemCount = 0;
+	accountRows();
 	invalidate();
 }
 
@@ -61,6 +66,37 @@ void GridLayout::swapRows(int a, int b) {
 	invalidate();
 }
 
+void GridLayout::applyDiff(const KeyedDiff &diff, const std::function<std::vector<QWidget*>(size_t)> &widgets) {
+	Q_ASSERT(diff.sources.size() + diff.removed.size() >= rows.size());
+	std::vector<Row> result;
+	result.reserve(diff.sources.size());
+	for(size_t i = 0; i < diff.sources.size(); ++i) {
+		const size_t source = diff.sources[i];
+		if(source != KeyedDiff::npos) {
+			Q_ASSERT(source < rows.size());
+			result.emplace_back(std::move(rows[source]));
+			continue;
+		}
+
+		auto &row = result.emplace_back(columns.size());
+		const auto rowWidgets = widgets(i);
+		Q_ASSERT(rowWidgets.size() <= columns.size());
+		for(size_t c = 0; c < rowWidgets.size(); ++c) {
+			if(!rowWidgets[c])
+				continue;
+			addChildWidget(rowWidgets[c]);
+			row.items[c] = std::unique_ptr<QLayoutItem>(new QWidgetItem(rowWidgets[c]));
+			++itemCount;
+		}
+	}
+
+	for(const size_t index : diff.removed)
+		clearRow(rows[index]);
+	rows = std::move(result);
+	accountRows();
+	invalidate();
+}
+
 int GridLayout::rowCount() const {
 	return static_cast<int>(rows.size());
 }
@@ -81,6 +117,7 @@ void GridLayout::setWidget(QWidget *widget, int row, int column) {
 	addChildWidget(widget);
 	ptr = std::unique_ptr<QLayoutItem>(new QWidgetItem(widget));
 	++itemCount;
+	accountRows();
 	invalidate();
 }
 
@@ -103,6 +140,7 @@ QLayoutItem *GridLayout::takeAt(int index) {
 		for(auto &v : row.items) {
 			if(v && index-- == 0) {
 				--itemCount;
+				accountRows();
 				return v.release();
 			}
 		}
@@ -171,6 +209,8 @@ Qt::Orientations GridLayout::expandingDirections() const {
 }
 
 void GridLayout::setGeometry(const QRect &rect) {
+	static LatencyHistogram &layoutTime = Metrics::instance().histogram("volumecontroller_layout_seconds", "Duration of session list layout passes");
+	ScopedLatency latency(layoutTime);
 //	qDebug() << "Setting geometry to" << rect;
 	for(auto &column : columns) {
 		column.width = 0;
@@ -262,6 +302,14 @@ void GridLayout::clearRow(GridLayout::Row &row) {
 		--itemCount;
 		v.reset();
 	}
+	accountRows();
+}
+
+void GridLayout::accountRows() {
+	const qint64 slots = qint64(rows.size() * columns.size());
+	const qint64 bytes = qint64(rows.capacity() * sizeof(Row)) + slots * qint64(sizeof(std::unique_ptr<QLayoutItem>))
+			+ qint64(itemCount) * qint64(sizeof(QWidgetItem));
+	rowMemory.resize(bytes, qint64(rows.size()));
 }
 
 bool GridLayout::hasHeightForWidth() const {
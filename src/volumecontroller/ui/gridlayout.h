@@ -2,7 +2,10 @@
 #define GRIDLAYOUT_H
 
 #include <QLayout>
+#include <functional>
 #include "volumecontroller/collections.h"
+#include "volumecontroller/keyeddiff.h"
+#include "volumecontroller/memoryaccounting.h"
 
 class GridLayout : public QLayout {
 public:
@@ -49,6 +52,8 @@ public:
 	void removeRows(const Iterator begin, const Iterator end) {
 		const auto it = RemoveIndices(rows.begin(), rows.end(), begin, end);
 		rows.erase(it, rows.end());
+		accountRows();
+		invalidate();
 	}
 
 	template<typename Collection>
@@ -61,6 +66,10 @@ public:
 	void clearRows();
 
 	void swapRows(int a, int b);
+
+	// Rebuilds the rows in the order of diff.sources and invalidates once,
+	// inserted rows are filled with widgets(targetRow), one widget or nullptr per column
+	void applyDiff(const KeyedDiff &diff, const std::function<std::vector<QWidget*>(size_t)> &widgets);
 	void ensureRows(int row);
 
 	int rowCount() const;
@@ -84,6 +93,8 @@ public:
 
 private:
 	void clearRow(Row &row);
+	// Refreshes the accounted size after rows or items were added or removed, rows always have one slot per column
+	void accountRows();
 
 	std::unique_ptr<QLayoutItem> &itemPtrAt(int row, int column);
 	QLayoutItem *itemPtrAt(int row, int column) const;
@@ -95,6 +106,7 @@ private:
 	std::vector<Row> rows;
 	int totalWeight = 0;
 	int itemCount = 0;
+	MemoryAccount rowMemory{MemoryCategory::LayoutRows, 0, 0};
 };
 
 #endif // GRIDLAYOUT_H
@@ -0,0 +1,182 @@
+#include "perfoverlay.h"
+#include "devicevolumecontroller.h"
+#include "volumecontroller/audio/audiothread.h"
+#include "volumecontroller/metrics.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <algorithm>
+
+constexpr int sampleInterval = 100;
+constexpr int rowHeight = 22;
+constexpr int textWidth = 150;
+constexpr int sparklineWidth = 120;
+constexpr int margin = 6;
+
+HistogramWindow::HistogramWindow(std::vector<const LatencyHistogram*> histograms) : histograms(std::move(histograms)) {
+	advance();
+}
+
+void HistogramWindow::advance() {
+	std::array<quint64, LatencyHistogram::bucketCount> current{};
+	qint64 sumUs = 0;
+	for(const auto histogram : histograms) {
+		for(int i = 0; i < LatencyHistogram::bucketCount; ++i)
+			current[size_t(i)] += histogram->bucket(i);
+		sumUs += histogram->sumUs();
+	}
+
+	_count = 0;
+	for(size_t i = 0; i < current.size(); ++i) {
+		window[i] = current[i] - last[i];
+		_count += window[i];
+	}
+	windowSumUs = sumUs - lastSumUs;
+	last = current;
+	lastSumUs = sumUs;
+}
+
+qreal HistogramWindow::averageUs() const {
+	return _count > 0 ? qreal(windowSumUs) / _count : 0.0;
+}
+
+qint64 HistogramWindow::percentileUs(qreal percentile) const {
+	if(_count == 0)
+		return 0;
+	const quint64 target = quint64(percentile * _count);
+	quint64 seen = 0;
+	for(int i = 0; i < LatencyHistogram::bucketCount; ++i) {
+		seen += window[size_t(i)];
+		if(seen > target)
+			return LatencyHistogram::bucketUpperBoundUs(i);
+	}
+	return LatencyHistogram::bucketUpperBoundUs(LatencyHistogram::bucketCount - 1);
+}
+
+static std::vector<const LatencyHistogram*> BackendHistograms() {
+	std::vector<const LatencyHistogram*> histograms;
+	for(int i = 0; i < int(BackendMethod::Count); ++i)
+		histograms.push_back(&BackendTrace::instance().histogram(BackendMethod(i)));
+	return histograms;
+}
+
+template<typename F>
+static size_t Sum(const std::vector<DeviceVolumeController*> &devices, F &&f) {
+	size_t sum = 0;
+	for(const DeviceVolumeController *device : devices)
+		sum += f(device->controlList());
+	return sum;
+}
+
+PerfOverlay::PerfOverlay(QWidget *parent, const std::vector<DeviceVolumeController*> &devices)
+	: QWidget(parent),
+	  frameWork({&Metrics::instance().histogram("volumecontroller_frame_work_seconds", "")}),
+	  paintTime({&Metrics::instance().histogram("volumecontroller_paint_seconds", "")}),
+	  meterPoll({&Metrics::instance().histogram("volumecontroller_meter_poll_seconds", "")}),
+	  backendCalls(BackendHistograms())
+{
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setAttribute(Qt::WA_NoSystemBackground);
+
+	sampleTimer.setInterval(sampleInterval);
+	connect(&sampleTimer, &QTimer::timeout, this, &PerfOverlay::sample);
+
+	addSeries("frame", "ms", [this]() { return frameWork.averageUs() / 1000.0; });
+	addSeries("paint/row", "us", [this, &devices]() {
+		return paintTime.averageUs() / std::max<size_t>(1, Sum(devices, [](const VolumeControlList &list) { return list.rowCount(); }));
+	});
+	addSeries("queue", "", [&devices]() {
+		return qreal(AudioThread::instance().queueDepth()) + Sum(devices, [](const VolumeControlList &list) { return list.pendingChangeCount(); });
+	});
+	addSeries("meter poll", "us", [this]() { return meterPoll.averageUs(); });
+	addSeries("backend p50", "us", [this]() { return qreal(backendCalls.percentileUs(0.5)); });
+	addSeries("backend p99", "us", [this]() { return qreal(backendCalls.percentileUs(0.99)); });
+	addSeries("widgets", "", [this]() { return qreal(parentWidget()->findChildren<QWidget*>().size()); });
+	addSeries("cache hits", "%", [this]() {
+		const char *caches[] = {"main_windows", "volume_icons"};
+		quint64 hits = 0;
+		quint64 requests = 0;
+		for(const char *cache : caches) {
+			const QByteArray labels = QByteArray("cache=\"") + cache + "\",result=\"";
+			const auto hitCount = CacheRequests((labels + "hit\"").constData()).value();
+			hits += hitCount;
+			requests += hitCount + CacheRequests((labels + "miss\"").constData()).value();
+		}
+		const quint64 windowRequests = requests - lastCacheRequests;
+		const quint64 windowHits = hits - lastCacheHits;
+		lastCacheHits = hits;
+		lastCacheRequests = requests;
+		return windowRequests > 0 ? 100.0 * windowHits / windowRequests : 100.0;
+	});
+
+	resize(margin * 3 + textWidth + sparklineWidth, margin * 2 + rowHeight * int(series.size()));
+	hide();
+}
+
+void PerfOverlay::addSeries(QString label, QString unit, std::function<qreal()> sample) {
+	series.push_back(Series{std::move(label), std::move(unit), std::move(sample), {}});
+}
+
+void PerfOverlay::showEvent(QShowEvent *) {
+	raise();
+	// only count what happens while visible
+	frameWork.advance();
+	paintTime.advance();
+	meterPoll.advance();
+	backendCalls.advance();
+	sampleTimer.start();
+}
+
+void PerfOverlay::hideEvent(QHideEvent *) {
+	sampleTimer.stop();
+	for(auto &s : series)
+		s.values.clear();
+}
+
+void PerfOverlay::sample() {
+	frameWork.advance();
+	paintTime.advance();
+	meterPoll.advance();
+	backendCalls.advance();
+	for(auto &s : series)
+		s.values.push(s.sample());
+	update();
+}
+
+void PerfOverlay::paintEvent(QPaintEvent *) {
+	QPainter painter(this);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.fillRect(rect(), QColor(0, 0, 0, 180));
+	painter.setPen(Qt::white);
+
+	int y = margin;
+	for(const auto &s : series) {
+		const QRect textRect(margin, y, textWidth, rowHeight);
+		const QString value = s.values.empty() ? QString("-") : QString::number(s.values.back(), 'f', s.values.back() < 10 ? 2 : 0);
+		painter.drawText(textRect, Qt::AlignVCenter | Qt::AlignLeft, s.label);
+		painter.drawText(textRect, Qt::AlignVCenter | Qt::AlignRight, value + ' ' + s.unit);
+
+		if(s.values.size() > 1) {
+			qreal maximum = 0;
+			for(size_t i = 0; i < s.values.size(); ++i)
+				maximum = std::max(maximum, s.values[i]);
+			const QRectF lineRect(margin * 2 + textWidth, y + 3, sparklineWidth, rowHeight - 6);
+			const qreal step = lineRect.width() / (s.values.capacity() - 1);
+			const qreal x0 = lineRect.right() - step * (s.values.size() - 1);
+			QPainterPath path;
+			for(size_t i = 0; i < s.values.size(); ++i) {
+				const qreal level = maximum > 0 ? s.values[i] / maximum : 0;
+				const QPointF point(x0 + step * i, lineRect.bottom() - level * lineRect.height());
+				if(i == 0)
+					path.moveTo(point);
+				else
+					path.lineTo(point);
+			}
+			painter.setPen(QColor(120, 200, 255));
+			painter.drawPath(path);
+			painter.setPen(Qt::white);
+		}
+		y += rowHeight;
+	}
+}
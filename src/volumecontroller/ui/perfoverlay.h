@@ -0,0 +1,68 @@
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include "volumecontroller/ringbuffer.h"
+#include "volumecontroller/audio/backendtrace.h"
+
+#include <QTimer>
+#include <QWidget>
+
+#include <functional>
+#include <vector>
+
+class DeviceVolumeController;
+
+// Histogram entries recorded between two calls of advance()
+class HistogramWindow {
+public:
+	explicit HistogramWindow(std::vector<const LatencyHistogram*> histograms);
+
+	void advance();
+
+	quint64 count() const { return _count; }
+	qreal averageUs() const;
+	// upper bound of the bucket containing the percentile
+	qint64 percentileUs(qreal percentile) const;
+
+private:
+	std::vector<const LatencyHistogram*> histograms;
+	std::array<quint64, LatencyHistogram::bucketCount> last{};
+	std::array<quint64, LatencyHistogram::bucketCount> window{};
+	qint64 lastSumUs = 0;
+	qint64 windowSumUs = 0;
+	quint64 _count = 0;
+};
+
+// Live sparklines drawn over the window, samples only while visible
+class PerfOverlay : public QWidget {
+public:
+	// Rows and pending changes are summed over devices, which may change while the overlay lives
+	PerfOverlay(QWidget *parent, const std::vector<DeviceVolumeController*> &devices);
+
+protected:
+	void showEvent(QShowEvent *event) override;
+	void hideEvent(QHideEvent *event) override;
+	void paintEvent(QPaintEvent *event) override;
+
+private:
+	struct Series {
+		QString label;
+		QString unit;
+		std::function<qreal()> sample;
+		RingBuffer<qreal, 120> values;
+	};
+
+	void addSeries(QString label, QString unit, std::function<qreal()> sample);
+	void sample();
+
+	QTimer sampleTimer;
+	std::vector<Series> series;
+	HistogramWindow frameWork;
+	HistogramWindow paintTime;
+	HistogramWindow meterPoll;
+	HistogramWindow backendCalls;
+	quint64 lastCacheHits = 0;
+	quint64 lastCacheRequests = 0;
+};
+
+#endif // PERFOVERLAY_H
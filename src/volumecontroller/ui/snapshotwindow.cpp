@@ -0,0 +1,26 @@
+#include "snapshotwindow.h"
+
+#include <QPainter>
+
+SnapshotWindow::SnapshotWindow() : QWidget(nullptr, Qt::Tool | Qt::FramelessWindowHint) {
+	setAttribute(Qt::WA_TranslucentBackground);
+	setAttribute(Qt::WA_ShowWithoutActivating);
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setAttribute(Qt::WA_NoSystemBackground);
+}
+
+void SnapshotWindow::setSnapshot(QPixmap pixmap) {
+	_snapshot = std::move(pixmap);
+	resize(_snapshot.size() / _snapshot.devicePixelRatioF());
+	update();
+}
+
+void SnapshotWindow::clearSnapshot() {
+	_snapshot = QPixmap();
+}
+
+void SnapshotWindow::paintEvent(QPaintEvent *) {
+	QPainter painter(this);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.drawPixmap(0, 0, _snapshot);
+}
@@ -0,0 +1,24 @@
+#ifndef SNAPSHOTWINDOW_H
+#define SNAPSHOTWINDOW_H
+
+#include <QPixmap>
+#include <QWidget>
+
+// Frameless top level window showing a static image of another window, used to animate without repainting the live widgets.
+class SnapshotWindow : public QWidget {
+public:
+	SnapshotWindow();
+
+	void setSnapshot(QPixmap pixmap);
+	void clearSnapshot();
+
+	const QPixmap &snapshot() const noexcept { return _snapshot; }
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+
+private:
+	QPixmap _snapshot;
+};
+
+#endif // SNAPSHOTWINDOW_H
@@ -0,0 +1,59 @@
+#include "themeresources.h"
+#include "volumecontroller/metrics.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <algorithm>
+
+ThemeResources &ThemeResources::instance() {
+	static ThemeResources resources;
+	return resources;
+}
+
+std::shared_ptr<const VolumeIcons> ThemeResources::volumeIcons(const IconTheme &theme, QSize size, qreal devicePixelRatio) {
+	const Key key(&theme, size.width(), size.height(), devicePixelRatio);
+	auto it = volumeIconsCache.find(key);
+	static Counter &hitCounter = CacheRequests("cache=\"volume_icons\",result=\"hit\"");
+	static Counter &missCounter = CacheRequests("cache=\"volume_icons\",result=\"miss\"");
+	if(it != volumeIconsCache.end()) {
+		++hits;
+		hitCounter.add();
+		return it->second;
+	}
+
+	++misses;
+	missCounter.add();
+	QElapsedTimer timer;
+	timer.start();
+	auto icons = std::make_shared<const VolumeIcons>(size, theme, devicePixelRatio);
+	volumeIconsCache.emplace(key, icons);
+	qDebug() << "Rendered volume icons of size" << size << "at dpr" << devicePixelRatio << "in" << timer.nsecsElapsed() / 1000 << "us,"
+				<< hits << "hits" << misses << "misses";
+	return icons;
+}
+
+void ThemeResources::preload(const Theme &theme, QSize traySize, QSize deviceSize, qreal devicePixelRatio) {
+	volumeIcons(theme.icon(), traySize, devicePixelRatio);
+	volumeIcons(theme.device().icon(), deviceSize, devicePixelRatio);
+}
+
+void ThemeResources::purgeUnusedDevicePixelRatios() {
+	const auto screens = QGuiApplication::screens();
+	const auto isUsed = [&](qreal devicePixelRatio) {
+		return std::any_of(screens.begin(), screens.end(), [&](const QScreen *screen) {
+			return qFuzzyCompare(screen->devicePixelRatio(), devicePixelRatio);
+		});
+	};
+
+	for(auto it = volumeIconsCache.begin(); it != volumeIconsCache.end();) {
+		if(isUsed(std::get<3>(it->first))) {
+			++it;
+		} else {
+			qDebug() << "Dropping volume icons for unused dpr" << std::get<3>(it->first);
+			it = volumeIconsCache.erase(it);
+		}
+	}
+}
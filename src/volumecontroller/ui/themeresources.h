@@ -0,0 +1,37 @@
+#ifndef THEMERESOURCES_H
+#define THEMERESOURCES_H
+
+#include "volumecontroller/ui/theme.h"
+#include "volumecontroller/ui/volumeicons.h"
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+// Process wide cache of rendered glyph icons. There is only one glyph set so far, entries are keyed by
+// (theme, logical size, device pixel ratio) and rendered on first use.
+class ThemeResources {
+public:
+	Q_DISABLE_COPY_MOVE(ThemeResources);
+
+	static ThemeResources &instance();
+
+	std::shared_ptr<const VolumeIcons> volumeIcons(const IconTheme &theme, QSize size, qreal devicePixelRatio);
+
+	void preload(const Theme &theme, QSize traySize, QSize deviceSize, qreal devicePixelRatio);
+
+	// Drops all entries rendered for a device pixel ratio no screen uses anymore,
+	// consumers keep their icons alive until they requested the new ones.
+	void purgeUnusedDevicePixelRatios();
+
+private:
+	ThemeResources() = default;
+
+	using Key = std::tuple<const IconTheme *, int, int, qreal>;
+
+	std::map<Key, std::shared_ptr<const VolumeIcons>> volumeIconsCache;
+	int hits = 0;
+	int misses = 0;
+};
+
+#endif // THEMERESOURCES_H
@@ -5,11 +5,21 @@
 #include "volumecontroller/info/processdata.h"
 
 #include "volumecontroller/audio/audiodevicemanager.h"
+#include "volumecontroller/audio/backendtrace.h"
+#include "volumecontroller/endpointplan.h"
+#include "volumecontroller/internedstring.h"
+#include "volumecontroller/memoryaccounting.h"
+#include "volumecontroller/metrics.h"
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QDebug>
 #include <QScreen>
 #include <QDir>
 #include <QSettings>
+#include <QMessageBox>
+#include <QKeyEvent>
+
+#include <algorithm>
 
 constexpr QSize trayIconSize = QSize(32, 32);
 
@@ -18,12 +28,18 @@ const struct {
 	QString transparentTheme = "transparent";
 	QString transparentThemeTransparency = "transparent-transparency";
 	QString showInactive = "show-inactive";
+	QString groupByExecutable = "group-by-executable";
+	QString snapshotAnimation = "snapshot-animation";
+	QString lazySessionList = "lazy-session-list";
+	QString backendStallThreshold = "backend-stall-threshold";
 } settingsKeys;
 
 VolumeController::VolumeController(QWidget *parent, CustomStyle &style)
 	: QWidget(parent),
 	  windowFadeAnimation(this),
 	  windowFlyAnimation(this, {0, 0}, {0, 0}),
+	  snapshotFadeAnimation(&snapshotWindow),
+	  snapshotFlyAnimation(&snapshotWindow, {0, 0}, {0, 0}),
 	  _style(style)
 {
 	settingsPath = QDir::cleanPath(QApplication::applicationDirPath() + QDir::separator() + "settings.ini");
@@ -33,11 +49,16 @@ VolumeController::VolumeController(QWidget *parent, CustomStyle &style)
 	transparentTheme = settings.value(settingsKeys.transparentTheme, false).toBool();
 	transparentThemeAlpha = settings.value(settingsKeys.transparentThemeTransparency, 0.96078431).toReal();
 	const auto showInactive = settings.value(settingsKeys.showInactive, false).toBool();
+	const auto groupByExecutable = settings.value(settingsKeys.groupByExecutable, false).toBool();
+	snapshotAnimation = settings.value(settingsKeys.snapshotAnimation, true).toBool();
+	lazySessionList = settings.value(settingsKeys.lazySessionList, true).toBool();
+	BackendTrace::instance().setStallThresholdMs(settings.value(settingsKeys.backendStallThreshold, 100).toInt());
 
 	const Theme &theme = SelectTheme(darkTheme);
 	setBaseTheme(theme.base());
 	setStyleTheme(theme);
-	trayVolumeIcons = VolumeIcons(trayIconSize, theme.icon());
+	trayDevicePixelRatio = QGuiApplication::primaryScreen()->devicePixelRatio();
+	trayVolumeIcons = ThemeResources::instance().volumeIcons(theme.icon(), trayIconSize, trayDevicePixelRatio);
 
 	QSizePolicy sizePolicy1(QSizePolicy::Preferred, QSizePolicy::Preferred);
 	sizePolicy1.setHorizontalStretch(0);
@@ -45,9 +66,15 @@ VolumeController::VolumeController(QWidget *parent, CustomStyle &style)
 	sizePolicy1.setHeightForWidth(sizePolicy().hasHeightForWidth());
 	setSizePolicy(sizePolicy1);
 
-	qDebug() << "Creating audio device manager";
-	auto optManager = AudioDeviceManager::Default();
-	Q_ASSERT(optManager.has_value());
+	// registered first, so no change during the startup is missed
+	endpointTimer.setSingleShot(true);
+	endpointTimer.setInterval(100);
+	connect(&endpointTimer, &QTimer::timeout, this, &VolumeController::reconcileEndpoints);
+	endpointNotification = EndpointNotification::Register();
+	if(endpointNotification) {
+		connect(endpointNotification.get(), &EndpointNotification::endpointsChanged, this, &VolumeController::onEndpointsChanged,
+				  Qt::ConnectionType::QueuedConnection);
+	}
 
 	setMinimumWidth(320);
 	QGridLayout *layout = new QGridLayout(this);
@@ -55,20 +82,82 @@ VolumeController::VolumeController(QWidget *parent, CustomStyle &style)
 	layout->setAlignment(Qt::AlignTop);
 	layout->setContentsMargins(0, 0, 0, 0);
 
-	deviceVolumeController = new DeviceVolumeController(this, std::move(*optManager), theme.device(), showInactive);
-	layout->addWidget(deviceVolumeController, 0, 0);
+	sessionSnapshotPath = QDir::cleanPath(QApplication::applicationDirPath() + QDir::separator() + "sessions.dat");
+	const bool snapshotLoaded = sessionSnapshot.load(sessionSnapshotPath);
+	qDebug() << "Session snapshot with" << sessionSnapshot.size() << "programs loaded:" << snapshotLoaded;
+	if(snapshotLoaded && sessionSnapshot.windowSize().isValid())
+		resize(sessionSnapshot.windowSize());
+	startupSnapshot = snapshotLoaded;
+
+	profiles = std::make_unique<VolumeProfiles>(QDir::cleanPath(QApplication::applicationDirPath() + QDir::separator() + "profiles.ini"));
+
+	filterEdit = new QLineEdit(this);
+	filterEdit->setPlaceholderText(tr("Filter"));
+	filterEdit->setClearButtonEnabled(true);
+	filterEdit->hide();
+
+	layoutDeviceSections();
+	perfOverlay = new PerfOverlay(this, deviceVolumeControllers);
+
+	connect(filterEdit, &QLineEdit::textChanged, this, [this](const QString &text) {
+		for(auto *controller : deviceVolumeControllers)
+			controller->controlList().setFilter(text);
+		if(text.isEmpty()) {
+			filterEdit->hide();
+			setFocus();
+		}
+	});
+	connect(&frameScheduler, &FrameScheduler::frame, this, &VolumeController::updatePeaks);
 
-	createActions(showInactive, darkTheme, transparentTheme);
+	createActions(showInactive, groupByExecutable, darkTheme, transparentTheme);
 	createTray();
 	trayIcon->show();
+	qDebug() << "Tray ready" << ProcessData::GetProcessUptime() << "ms after process start";
+
+	// the sections are added once their endpoints are opened in the background
+	qDebug() << "Opening audio endpoints";
+	reconcileEndpoints();
+
+	connect(&snapshotFadeAnimation.inAnimation(), &QPropertyAnimation::finished, this, &VolumeController::showLiveWindow);
+	// the window is shown at opacity 0 before the fade, the first frame is the first one that can be seen
+	const auto onFadeIn = [this](const QVariant &opacity) {
+		if(opacity.toReal() > 0.0)
+			recordFirstFrame();
+	};
+	connect(&snapshotFadeAnimation.inAnimation(), &QPropertyAnimation::valueChanged, this, onFadeIn);
+	connect(&windowFadeAnimation.inAnimation(), &QPropertyAnimation::valueChanged, this, onFadeIn);
+
+	prewarmTimer.setSingleShot(true);
+	prewarmTimer.setInterval(250);
+	connect(&prewarmTimer, &QTimer::timeout, this, &VolumeController::prewarm);
+	invalidateFirstFrame();
+
+	connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this, &VolumeController::watchPrimaryScreen);
+	watchPrimaryScreen(QGuiApplication::primaryScreen());
+
+	// render the other theme's icons in idle time so the first switch is only a pointer swap as well
+	QTimer::singleShot(0, this, [this, darkTheme]() {
+		ThemeResources::instance().preload(SelectTheme(!darkTheme), trayIconSize, deviceVolumeIconSize, trayDevicePixelRatio);
+	});
 }
 
 VolumeController::~VolumeController() {
 	saveSettings();
+	saveSessionSnapshot();
 	qDebug() << "Destroying.";
+	if(endpointNotification)
+		endpointNotification->unregister();
+	// stop session notifications before the profiles they read from go away
+	for(auto *controller : deviceVolumeControllers)
+		delete controller;
+	deviceVolumeControllers.clear();
+	deviceVolumeController = nullptr;
+	AudioThread::instance().stop();
+	BackendTrace::instance().logSummary();
+	InternedString::logStatistics();
 }
 
-void VolumeController::createActions(bool showInactiveInitial, bool darkThemeInitial, bool transparentInitial) {
+void VolumeController::createActions(bool showInactiveInitial, bool groupByExecutableInitial, bool darkThemeInitial, bool transparentInitial) {
 	qDebug() << "Creating actions";
 	showAction = new QAction(tr("Show"), this);
 	connect(showAction, &QAction::triggered, this, &VolumeController::fadeIn);
@@ -78,6 +167,11 @@ void VolumeController::createActions(bool showInactiveInitial, bool darkThemeIni
 	showInactiveAction->setChecked(showInactiveInitial);
 	connect(showInactiveAction, &QAction::toggled, this, &VolumeController::setShowInactive);
 
+	groupByExecutableAction = new QAction(tr("Group by program"), this);
+	groupByExecutableAction->setCheckable(true);
+	groupByExecutableAction->setChecked(groupByExecutableInitial);
+	connect(groupByExecutableAction, &QAction::toggled, this, &VolumeController::setGroupByExecutable);
+
 	toggleDarkThemeAction = new QAction(tr("Dark theme"), this);
 	toggleDarkThemeAction->setCheckable(true);
 	toggleDarkThemeAction->setChecked(darkThemeInitial);
@@ -88,10 +182,31 @@ void VolumeController::createActions(bool showInactiveInitial, bool darkThemeIni
 	toggleTransparentAction->setChecked(transparentInitial);
 	connect(toggleTransparentAction, &QAction::toggled, this, &VolumeController::setTransparentTheme);
 
+	backendStatisticsAction = new QAction(tr("Backend statistics"), this);
+	connect(backendStatisticsAction, &QAction::triggered, this, &VolumeController::showBackendStatistics);
+
+	memoryReportAction = new QAction(tr("Dump memory report"), this);
+	connect(memoryReportAction, &QAction::triggered, this, [] {
+		MemoryAccounting::logReport();
+	});
+
+	perfOverlayAction = new QAction(tr("Performance overlay"), this);
+	perfOverlayAction->setCheckable(true);
+	connect(perfOverlayAction, &QAction::toggled, this, [this](bool checked) {
+		perfOverlay->setVisible(checked);
+	});
+
 	exitAction = new QAction(tr("Exit"), this);
 	connect(exitAction, &QAction::triggered, this, &VolumeController::close);
 }
 
+void VolumeController::showBackendStatistics() {
+	BackendTrace::instance().logSummary();
+	QMessageBox box(QMessageBox::Information, tr("Backend statistics"), BackendTrace::instance().summary());
+	box.setStyleSheet("QLabel { font-family: Consolas; }");
+	box.exec();
+}
+
 void VolumeController::createTray() {
 	qDebug() << "Creating tray";
 	trayMenu = new QMenu(this);
@@ -99,9 +214,13 @@ void VolumeController::createTray() {
 	trayMenu->addAction(showAction);
 	trayMenu->addSeparator();
 	trayMenu->addAction(showInactiveAction);
+	trayMenu->addAction(groupByExecutableAction);
 	trayMenu->addAction(toggleDarkThemeAction);
 	trayMenu->addAction(toggleTransparentAction);
 	trayMenu->addSeparator();
+	trayMenu->addAction(backendStatisticsAction);
+	trayMenu->addAction(memoryReportAction);
+	trayMenu->addAction(perfOverlayAction);
 	trayMenu->addAction(exitAction);
 
 	trayIcon = new QSystemTrayIcon(this);
@@ -110,14 +229,14 @@ void VolumeController::createTray() {
 
 	connect(trayIcon, &QSystemTrayIcon::activated, [this](QSystemTrayIcon::ActivationReason reason) {
 		if(reason == QSystemTrayIcon::ActivationReason::Trigger) {
-			if(isVisible())
+			if(isShowing()) {
 				fadeOut();
-			else
+			} else {
+				activationTimer.start();
 				fadeIn();
+			}
 		}
 	});
-
-	connect(&deviceVolumeController->deviceVolumeItem(), &DeviceVolumeItem::volumeChanged, this, &VolumeController::onDeviceVolumeChanged);
 }
 
 void VolumeController::saveSettings() {
@@ -126,7 +245,11 @@ void VolumeController::saveSettings() {
 	settings.setValue(settingsKeys.darkTheme, toggleDarkThemeAction->isChecked());
 	settings.setValue(settingsKeys.transparentThemeTransparency, transparentThemeAlpha);
 	settings.setValue(settingsKeys.transparentTheme, toggleTransparentAction->isChecked());
-	settings.setValue(settingsKeys.showInactive, deviceVolumeController->controlList().showInactive());
+	settings.setValue(settingsKeys.showInactive, showInactiveAction->isChecked());
+	settings.setValue(settingsKeys.groupByExecutable, groupByExecutableAction->isChecked());
+	settings.setValue(settingsKeys.snapshotAnimation, snapshotAnimation);
+	settings.setValue(settingsKeys.lazySessionList, lazySessionList);
+	settings.setValue(settingsKeys.backendStallThreshold, BackendTrace::instance().stallThresholdMs());
 	settings.sync();
 }
 
@@ -147,14 +270,82 @@ void VolumeController::onDeviceVolumeChanged(const int volume) {
 }
 
 void VolumeController::updateTray() {
-	const auto volume = deviceVolumeController->deviceControl().volume().value_or(0.0f) * 100.0f;
+	// no section until the first endpoints are opened
+	const auto volume = deviceVolumeController ? deviceVolumeController->deviceControl().volume().value_or(0.0f) * 100.0f : 0.0f;
 	updateTray(volume);
 }
 
 const QString trayToolTipPattern("%1: %2%");
 void VolumeController::updateTray(const int volume) {
-	trayIcon->setIcon(trayVolumeIcons.selectIcon(volume));
-	trayIcon->setToolTip(trayToolTipPattern.arg(deviceVolumeController->deviceName(), QString::number(volume)));
+	trayIcon->setIcon(trayVolumeIcons->selectIcon(volume));
+	trayIcon->setToolTip(deviceVolumeController ? trayToolTipPattern.arg(deviceVolumeController->deviceName(), QString::number(volume)) : QString());
+}
+
+QString VolumeController::runCommand(const QStringList &command) {
+	if(command.isEmpty())
+		return "empty command";
+	const QString &name = command.first();
+	const QStringList arguments = command.mid(1);
+
+	if(name == "show" || name == "hide" || name == "toggle") {
+		if(!arguments.isEmpty())
+			return name + " takes no arguments";
+		const bool show = name == "toggle" ? !isShowing() : name == "show";
+		if(show) {
+			activationTimer.start();
+			fadeIn();
+		} else if(isShowing()) {
+			fadeOut();
+		}
+		return {};
+	}
+
+	// runs the same path as a device change notification
+	if(name == "rescan-endpoints") {
+		if(!arguments.isEmpty())
+			return name + " takes no arguments";
+		onEndpointsChanged();
+		return {};
+	}
+
+	std::vector<VolumeItemBase*> items;
+	const auto selectItems = [&](int count) -> QString {
+		if(arguments.size() != count && arguments.size() != count + 1)
+			return "wrong number of arguments for " + name;
+		if(arguments.size() == count) {
+			if(!deviceVolumeController)
+				return "no endpoint opened yet";
+			items.push_back(&deviceVolumeController->deviceVolumeItem());
+			return {};
+		}
+		for(auto *controller : deviceVolumeControllers) {
+			const auto sessionItems = controller->controlList().findItems(arguments.first());
+			items.insert(items.end(), sessionItems.begin(), sessionItems.end());
+		}
+		if(items.empty())
+			return "no session found for " + arguments.first();
+		return {};
+	};
+
+	if(name == "volume") {
+		if(const QString error = selectItems(1); !error.isEmpty())
+			return error;
+		bool ok;
+		const int volume = arguments.last().toInt(&ok);
+		if(!ok || volume < 0 || volume > 100)
+			return "volume must be between 0 and 100";
+		for(auto *item : items)
+			item->setVolume(volume);
+		return {};
+	}
+	if(name == "mute" || name == "unmute") {
+		if(const QString error = selectItems(0); !error.isEmpty())
+			return error;
+		for(auto *item : items)
+			item->setMuted(name == "mute");
+		return {};
+	}
+	return "unknown command " + name;
 }
 
 void VolumeController::onApplicationInactive(const QWidget *activeWindow) {
@@ -165,22 +356,200 @@ void VolumeController::onApplicationInactive(const QWidget *activeWindow) {
 void VolumeController::showEvent(QShowEvent *) {
 	windowFadeAnimation.finishAnimation();
 	windowFlyAnimation.finishAnimation();
+	frameScheduler.setMetersActive(true);
+	for(auto *controller : deviceVolumeControllers)
+		controller->controlList().setDeferUpdates(false);
 }
 
 void VolumeController::hideEvent(QHideEvent *) {
 	windowFadeAnimation.finishAnimation();
 	windowFlyAnimation.finishAnimation();
+	frameScheduler.setMetersActive(false);
+	filterEdit->clear();
+	for(auto *controller : deviceVolumeControllers)
+		controller->controlList().setDeferUpdates(true);
+	if(!snapshotReady)
+		prewarmTimer.start();
+}
+
+void VolumeController::paintEvent(QPaintEvent *event) {
+	static Counter &paints = Metrics::instance().counter("volumecontroller_paints_total", "Paint events of the window");
+	static LatencyHistogram &paintTime = Metrics::instance().histogram("volumecontroller_paint_seconds", "Duration of window paint events");
+	paints.add();
+	ScopedLatency latency(paintTime);
+	QWidget::paintEvent(event);
+}
+
+void VolumeController::saveSessionSnapshot() {
+	if(!deviceVolumeController)
+		return;
+	const auto &list = deviceVolumeController->controlList();
+	if(!list.isPopulated())
+		return;
+	list.writeSnapshot(sessionSnapshot);
+	sessionSnapshot.setDevicePixelRatio(devicePixelRatioF());
+	sessionSnapshot.setWindowSize(size());
+	if(!sessionSnapshot.save(sessionSnapshotPath))
+		qWarning() << "Could not save the session snapshot to" << sessionSnapshotPath;
+}
+
+void VolumeController::keyPressEvent(QKeyEvent *event) {
+	if(event->key() == Qt::Key_Escape && filterEdit->isVisible()) {
+		filterEdit->clear();
+		return;
+	}
+	const QString text = event->text();
+	if(!filterEdit->hasFocus() && !text.isEmpty() && text.at(0).isPrint()) {
+		filterEdit->show();
+		filterEdit->setFocus();
+		filterEdit->insert(text);
+		return;
+	}
+	QWidget::keyPressEvent(event);
 }
 
 void VolumeController::fadeOut() {
-	windowFadeAnimation.out();
-	windowFlyAnimation.out();
+	if(!snapshotAnimation) {
+		frameScheduler.setAnimationLabel("live");
+		windowFadeAnimation.out();
+		windowFlyAnimation.out();
+		return;
+	}
+
+	if(snapshotFadeAnimation.inAnimation().state() == QAbstractAnimation::Running) {
+		snapshotFadeAnimation.finishAnimation();
+		snapshotFlyAnimation.finishAnimation();
+		showLiveWindow();
+	}
+	if(!isVisible())
+		return;
+
+	frameScheduler.setAnimationLabel("snapshot");
+	snapshotWindow.setSnapshot(grab());
+	snapshotWindow.move(pos());
+	snapshotWindow.setWindowOpacity(windowOpacity());
+	snapshotWindow.show();
+	snapshotReady = true;
+	hide();
+	snapshotFadeAnimation.out();
+	snapshotFlyAnimation.out();
 }
 
 void VolumeController::fadeIn() {
-	windowFadeAnimation.in();
-	windowFlyAnimation.in();
+	if(!snapshotAnimation) {
+		frameScheduler.setAnimationLabel("live");
+		for(auto *controller : deviceVolumeControllers)
+			controller->controlList().populate();
+		windowFadeAnimation.in();
+		windowFlyAnimation.in();
+		activateWindow();
+		return;
+	}
+
+	if(isShowing())
+		return;
+
+	snapshotFadeAnimation.finishAnimation();
+	snapshotFlyAnimation.finishAnimation();
+
+	frameScheduler.setAnimationLabel("snapshot");
+	prewarmTimer.stop();
+	// volumes that changed while hidden are still pending, the prewarmed frame shows the old ones
+	const bool valuesPending = std::any_of(deviceVolumeControllers.begin(), deviceVolumeControllers.end(), [](DeviceVolumeController *controller) {
+		return controller->controlList().pendingChangeCount() > 0;
+	});
+	if(!snapshotReady || valuesPending)
+		snapshotWindow.setSnapshot(grabSnapshot());
+	snapshotReady = false;
+	snapshotWindow.setWindowOpacity(0.0);
+	snapshotWindow.move(snapshotFlyAnimation.startValue());
+	snapshotFadeAnimation.in();
+	snapshotFlyAnimation.in();
+}
+
+bool VolumeController::isShowing() const {
+	return isVisible() || snapshotFadeAnimation.inAnimation().state() == QAbstractAnimation::Running;
+}
+
+QPixmap VolumeController::grabSnapshot() {
+	for(auto *controller : deviceVolumeControllers) {
+		controller->controlList().populate();
+		controller->controlList().applyPendingChanges();
+	}
+	ensurePolished();
+	layout()->activate();
+	adjustSize();
+	QPixmap pixmap = grab();
+	reposition();
+	return pixmap;
+}
+
+void VolumeController::showLiveWindow() {
+	setWindowOpacity(1.0);
+	move(visiblePosition());
+	show();
+	raise();
 	activateWindow();
+	snapshotWindow.hide();
+	snapshotWindow.clearSnapshot();
+}
+
+void VolumeController::invalidateFirstFrame() {
+	snapshotReady = false;
+	if(!isShowing())
+		prewarmTimer.start();
+}
+
+void VolumeController::prewarm() {
+	// a lazy list invalidates the frame again once populated
+	const bool populated = std::all_of(deviceVolumeControllers.begin(), deviceVolumeControllers.end(), [](DeviceVolumeController *controller) {
+		return controller->controlList().isPopulated();
+	});
+	if(isShowing() || snapshotReady || !populated)
+		return;
+
+	QElapsedTimer timer;
+	timer.start();
+	if(!testAttribute(Qt::WA_WState_Created))
+		create();
+	if(snapshotAnimation) {
+		snapshotWindow.setSnapshot(grabSnapshot());
+		snapshotReady = true;
+	} else {
+		for(auto *controller : deviceVolumeControllers)
+			controller->controlList().applyPendingChanges();
+		ensurePolished();
+		layout()->activate();
+		adjustSize();
+		reposition();
+	}
+	qDebug() << "Prewarmed hidden window in" << timer.nsecsElapsed() / 1000 << "us";
+}
+
+void VolumeController::recordFirstFrame() {
+	static LatencyHistogram &firstFrameTime = Metrics::instance().histogram("volumecontroller_first_frame_seconds",
+																								 "Time from activation until the window is visible, the target is one frame");
+	static Counter &withinTarget = Metrics::instance().counter("volumecontroller_first_frames_total", "Activations by their first frame",
+																				  "target=\"met\"");
+	static Counter &missedTarget = Metrics::instance().counter("volumecontroller_first_frames_total", "Activations by their first frame",
+																				  "target=\"missed\"");
+	if(!activationTimer.isValid())
+		return;
+
+	const qint64 elapsed = activationTimer.nsecsElapsed() / 1000;
+	activationTimer.invalidate();
+	firstFrameTime.record(elapsed);
+	++firstFrames;
+	if(elapsed <= frameScheduler.frameIntervalUs()) {
+		++firstFramesWithinTarget;
+		withinTarget.add();
+	} else {
+		missedTarget.add();
+	}
+	if(firstFrames == 1)
+		qDebug() << "First show" << elapsed << "us after activation," << ProcessData::GetProcessUptime() << "ms after process start";
+	qDebug() << "Time to first frame" << elapsed << "us, target" << frameScheduler.frameIntervalUs() << "us,"
+				<< firstFramesWithinTarget << "of" << firstFrames << "within target";
 }
 
 void VolumeController::resizeEvent(QResizeEvent *) {
@@ -188,15 +557,172 @@ void VolumeController::resizeEvent(QResizeEvent *) {
 }
 
 void VolumeController::setShowInactive(bool value) {
-	deviceVolumeController->controlList().setShowInactive(value);
+	for(auto *controller : deviceVolumeControllers)
+		controller->controlList().setShowInactive(value);
+}
+
+void VolumeController::setGroupByExecutable(bool value) {
+	for(auto *controller : deviceVolumeControllers)
+		controller->controlList().setGroupByExecutable(value);
+}
+
+DeviceVolumeController *VolumeController::createDeviceSection(AudioEndpoint &&endpoint, const DeviceVolumeControllerTheme &theme, bool showInactive,
+																				  bool groupByExecutable, const SessionSnapshot *snapshot) {
+	auto *controller = new DeviceVolumeController(this, std::move(endpoint), *profiles, theme, showInactive, lazySessionList, snapshot);
+	controller->controlList().setGroupByExecutable(groupByExecutable);
+	controller->controlList().setFilter(filterEdit->text());
+	controller->controlList().setDeferUpdates(!isVisible());
+	connect(controller, &DeviceVolumeController::contentChanged, this, &VolumeController::invalidateFirstFrame);
+	return controller;
+}
+
+void VolumeController::layoutDeviceSections() {
+	auto *grid = static_cast<QGridLayout*>(layout());
+	for(auto *controller : deviceVolumeControllers)
+		grid->removeWidget(controller);
+	grid->removeWidget(filterEdit);
+	for(size_t i = 0; i < deviceVolumeControllers.size(); ++i)
+		grid->addWidget(deviceVolumeControllers[i], int(i), 0);
+	grid->addWidget(filterEdit, int(deviceVolumeControllers.size()), 0);
+}
+
+void VolumeController::setPrimaryDevice(DeviceVolumeController *controller) {
+	if(controller == deviceVolumeController)
+		return;
+	qDebug() << "Tray follows" << controller->deviceName();
+	if(deviceVolumeController)
+		disconnect(&deviceVolumeController->deviceVolumeItem(), &DeviceVolumeItem::volumeChanged, this, &VolumeController::onDeviceVolumeChanged);
+	deviceVolumeController = controller;
+	connect(&deviceVolumeController->deviceVolumeItem(), &DeviceVolumeItem::volumeChanged, this, &VolumeController::onDeviceVolumeChanged);
+	updateTray();
+}
+
+void VolumeController::reuseProgramInformation(AudioSessionGroups &groups) {
+	size_t reused = 0;
+	for(auto &group : groups.groups()) {
+		for(auto *controller : deviceVolumeControllers) {
+			const ProgrammInformation *info = controller->programInformation(group->pid());
+			if(!info)
+				continue;
+			// the title stays interned and the icon shares its pixmaps
+			group->setInfoPtr(std::make_unique<ProgrammInformation>(info->title(), info->icon(), info->executable()));
+			++reused;
+			break;
+		}
+	}
+	qDebug() << "Reused the programs of" << reused << "of" << groups.groups().size() << "processes";
+}
+
+void VolumeController::onEndpointsChanged() {
+	if(!endpointSwitchTimer.isValid())
+		endpointSwitchTimer.start();
+	endpointTimer.start();
+}
+
+void VolumeController::reconcileEndpoints() {
+	// one build at a time, changes in between are picked up afterwards
+	if(openingEndpoints) {
+		endpointsDirty = true;
+		return;
+	}
+
+	std::vector<QString> known;
+	known.reserve(deviceVolumeControllers.size());
+	for(auto *controller : deviceVolumeControllers)
+		known.push_back(controller->deviceId());
+	// the sections only change in the callback, so known still matches them there
+	openingEndpoints = true;
+	OpenActiveEndpointsInBackground(std::move(known), this, [this](std::vector<QString> &&ids, std::vector<AudioEndpoint> &&opened) {
+		openingEndpoints = false;
+		if(ids.empty()) {
+			qWarning() << "No active endpoints left, keeping the current sections";
+			endpointSwitchTimer.invalidate();
+		} else {
+			applyEndpoints(ids, std::move(opened));
+		}
+		if(endpointsDirty) {
+			endpointsDirty = false;
+			reconcileEndpoints();
+		}
+	});
+}
+
+void VolumeController::applyEndpoints(const std::vector<QString> &ids, std::vector<AudioEndpoint> &&opened) {
+	static LatencyHistogram &switchTime = Metrics::instance().histogram("volumecontroller_endpoint_switch_seconds",
+																							 "Time from a device change notification until the sections are swapped");
+	const bool showInactive = showInactiveAction->isChecked();
+	const bool groupByExecutable = groupByExecutableAction->isChecked();
+	const auto &theme = SelectTheme(toggleDarkThemeAction->isChecked()).device();
+	// the snapshot only covers the sessions of the default endpoint of the first start
+	const SessionSnapshot *snapshot = startupSnapshot ? &sessionSnapshot : nullptr;
+	startupSnapshot = false;
+
+	const auto plan = PlanEndpoints(ids, deviceVolumeControllers, [](DeviceVolumeController *controller) {
+		return controller->deviceId();
+	}, opened, [](const AudioEndpoint &endpoint) {
+		return endpoint.id;
+	});
+	if(plan.empty()) {
+		qWarning() << "None of the active endpoints could be opened";
+		return;
+	}
+
+	std::vector<DeviceVolumeController*> sections;
+	sections.reserve(plan.sections.size());
+	size_t added = 0;
+	for(const auto &entry : plan.sections) {
+		if(entry.opened == plan.npos) {
+			sections.push_back(entry.section);
+			continue;
+		}
+		auto &endpoint = opened[entry.opened];
+		const bool isDefault = endpoint.id == ids.front();
+		reuseProgramInformation(endpoint.sessionGroups);
+		sections.push_back(createDeviceSection(std::move(endpoint), theme, showInactive, groupByExecutable, isDefault ? snapshot : nullptr));
+		++added;
+	}
+
+	// inserted, reordered and removed between two paints
+	setUpdatesEnabled(false);
+	setPrimaryDevice(sections.front());
+	for(auto *controller : plan.removed) {
+		qDebug() << "Removing section of" << controller->deviceName();
+		delete controller;
+	}
+	const size_t removed = plan.removed.size();
+	deviceVolumeControllers = std::move(sections);
+	layoutDeviceSections();
+	setUpdatesEnabled(true);
+	adjustSize();
+	invalidateFirstFrame();
+
+	if(endpointSwitchTimer.isValid()) {
+		const qint64 elapsed = endpointSwitchTimer.nsecsElapsed() / 1000;
+		switchTime.record(elapsed);
+		endpointSwitchTimer.invalidate();
+		qDebug().nospace() << "Switched endpoints in " << elapsed << " us including the debounce, " << added << " added, " << removed
+								 << " removed, " << deviceVolumeControllers.size() << " sections";
+	}
+}
+
+void VolumeController::updatePeaks(qreal dt) {
+	// one poll for all endpoints, the values read below are from the previous poll, one frame old at most
+	AudioThread::instance().pollPeaks();
+	for(auto *controller : deviceVolumeControllers)
+		controller->updatePeaks(dt);
 }
 
 void VolumeController::changeTheme(const Theme &theme) {
+	invalidateFirstFrame();
+	QElapsedTimer timer;
+	timer.start();
 	setBaseTheme(theme.base());
 	setStyleTheme(theme);
-	trayVolumeIcons = VolumeIcons(trayIconSize, theme.icon());
+	trayVolumeIcons = ThemeResources::instance().volumeIcons(theme.icon(), trayIconSize, trayDevicePixelRatio);
 	updateTray();
-	deviceVolumeController->changeTheme(theme.device());
+	for(auto *controller : deviceVolumeControllers)
+		controller->changeTheme(theme.device());
+	qDebug() << "Switched theme in" << timer.nsecsElapsed() / 1000 << "us";
 }
 
 void VolumeController::setBaseTheme(const BaseTheme &theme){
@@ -217,12 +743,38 @@ void VolumeController::setStyleTheme(const Theme &theme){
 	_style.sliderTheme = theme.slider();
 }
 
-void VolumeController::reposition() {
+void VolumeController::watchPrimaryScreen(QScreen *screen) {
+	disconnect(screenDpiConnection);
+	screenDpiConnection = connect(screen, &QScreen::logicalDotsPerInchChanged, this, &VolumeController::updateDevicePixelRatio);
+	updateDevicePixelRatio();
+}
+
+void VolumeController::updateDevicePixelRatio() {
+	const qreal devicePixelRatio = QGuiApplication::primaryScreen()->devicePixelRatio();
+	if(qFuzzyCompare(devicePixelRatio, trayDevicePixelRatio))
+		return;
+
+	qDebug() << "Device pixel ratio changed from" << trayDevicePixelRatio << "to" << devicePixelRatio;
+	trayDevicePixelRatio = devicePixelRatio;
+	trayVolumeIcons = ThemeResources::instance().volumeIcons(SelectTheme(toggleDarkThemeAction->isChecked()).icon(), trayIconSize, trayDevicePixelRatio);
+	updateTray();
+	for(auto *controller : deviceVolumeControllers)
+		controller->setDevicePixelRatio(devicePixelRatio);
+	ThemeResources::instance().purgeUnusedDevicePixelRatios();
+}
+
+QPoint VolumeController::visiblePosition() const {
 	const auto rect = QApplication::primaryScreen()->availableGeometry();
-	const QPoint visiblePoint(rect.width() - width(), rect.height() - height());
+	return QPoint(rect.width() - width(), rect.height() - height());
+}
+
+void VolumeController::reposition() {
+	const QPoint visiblePoint = visiblePosition();
 	const QPoint fadeOutPoint(visiblePoint.x(), visiblePoint.y() + height());
 	if(isVisible() && !windowFlyAnimation.isRunning())
 		move(visiblePoint);
 	windowFlyAnimation.setStartValue(fadeOutPoint);
 	windowFlyAnimation.setTargetValue(visiblePoint);
+	snapshotFlyAnimation.setStartValue(fadeOutPoint);
+	snapshotFlyAnimation.setTargetValue(visiblePoint);
 }
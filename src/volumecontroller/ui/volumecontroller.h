@@ -5,15 +5,22 @@
 #include "volumelistitem.h"
 #include "devicevolumecontroller.h"
 #include "animations.h"
+#include "framescheduler.h"
+#include "snapshotwindow.h"
+#include "perfoverlay.h"
 #include "customstyle.h"
 
 #include <QSystemTrayIcon>
 #include <QMenu>
 #include <QPropertyAnimation>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QLineEdit>
 
 #include <array>
 
 #include "volumeicons.h"
+#include "themeresources.h"
 #include "volumecontroller/ui/theme.h"
 
 QT_BEGIN_NAMESPACE
@@ -33,25 +40,35 @@ public:
 
 	void showEvent(QShowEvent *event) override;
 	void hideEvent(QHideEvent *event) override;
+	void paintEvent(QPaintEvent *event) override;
+	void keyPressEvent(QKeyEvent *event) override;
 
 	void fadeOut();
 	void fadeIn();
 
+	bool isShowing() const;
+
 	void resizeEvent(QResizeEvent *event) override;
 
 	void setShowInactive(bool value);
+	void setGroupByExecutable(bool value);
 
 	void changeTheme(const Theme &theme);
 
+	// Runs a command forwarded by another launch, returns an error message or an empty string
+	QString runCommand(const QStringList &command);
+
 private:
 	void setBaseTheme(const BaseTheme &theme);
 	void setStyleTheme(const Theme &theme);
 
-	void createActions(bool showInactiveInitial, bool darkThemeInitial, bool transparentInitial);
+	void createActions(bool showInactiveInitial, bool groupByExecutableInitial, bool darkThemeInitial, bool transparentInitial);
 	void createAnimations();
 	void createTray();
+	void showBackendStatistics();
 
 	void saveSettings();
+	void saveSessionSnapshot();
 
 	void setDarkTheme(bool value);
 	void setTransparentTheme(bool value);
@@ -61,10 +78,62 @@ private:
 	void updateTray(int volume);
 
 	void reposition();
+	QPoint visiblePosition() const;
+
+	QPixmap grabSnapshot();
+	void showLiveWindow();
+
+	void invalidateFirstFrame();
+	void prewarm();
+	void recordFirstFrame();
+
+	void updatePeaks(qreal dt);
+
+	DeviceVolumeController *createDeviceSection(AudioEndpoint &&endpoint, const DeviceVolumeControllerTheme &theme, bool showInactive, bool groupByExecutable,
+															  const SessionSnapshot *snapshot);
+	void layoutDeviceSections();
+	void setPrimaryDevice(DeviceVolumeController *controller);
+	void reuseProgramInformation(AudioSessionGroups &groups);
+
+	// The startup and device changes open new endpoints in the background and swap the sections in one step
+	void onEndpointsChanged();
+	void reconcileEndpoints();
+	void applyEndpoints(const std::vector<QString> &ids, std::vector<AudioEndpoint> &&opened);
+
+	void watchPrimaryScreen(QScreen *screen);
+	void updateDevicePixelRatio();
 
+	std::unique_ptr<VolumeProfiles> profiles;
+	SessionSnapshot sessionSnapshot;
+	QString sessionSnapshotPath;
+	// one section per endpoint, the first one is the default render endpoint and drives the tray
+	std::vector<DeviceVolumeController*> deviceVolumeControllers;
 	DeviceVolumeController *deviceVolumeController = nullptr;
+	ComPtr<EndpointNotification> endpointNotification;
+	// coalesces the notifications of one device change
+	QTimer endpointTimer;
+	QElapsedTimer endpointSwitchTimer;
+	bool openingEndpoints = false;
+	bool endpointsDirty = false;
+	// hidden until something is typed into the window
+	QLineEdit *filterEdit = nullptr;
+	PerfOverlay *perfOverlay = nullptr;
+	FrameScheduler frameScheduler;
 	FadeAnimation windowFadeAnimation;
 	FlyAnimation windowFlyAnimation;
+	SnapshotWindow snapshotWindow;
+	FadeAnimation snapshotFadeAnimation;
+	FlyAnimation snapshotFlyAnimation;
+	bool lazySessionList = true;
+	bool snapshotAnimation = true;
+	bool snapshotReady = false;
+	// the loaded snapshot waits for the section of the default endpoint
+	bool startupSnapshot = false;
+
+	QTimer prewarmTimer;
+	QElapsedTimer activationTimer;
+	int firstFrames = 0;
+	int firstFramesWithinTarget = 0;
 	CustomStyle &_style;
 
 	bool transparentTheme = false;
@@ -74,10 +143,16 @@ private:
 	QSystemTrayIcon *trayIcon = nullptr;
 	QAction *showAction = nullptr;
 	QAction *showInactiveAction = nullptr;
+	QAction *groupByExecutableAction = nullptr;
 	QAction *toggleTransparentAction = nullptr;
 	QAction *toggleDarkThemeAction = nullptr;
+	QAction *backendStatisticsAction = nullptr;
+	QAction *memoryReportAction = nullptr;
+	QAction *perfOverlayAction = nullptr;
 	QAction *exitAction = nullptr;
-	VolumeIcons trayVolumeIcons;
+	std::shared_ptr<const VolumeIcons> trayVolumeIcons;
+	qreal trayDevicePixelRatio = qreal(1);
+	QMetaObject::Connection screenDpiConnection;
 
 	QString settingsPath;
 };
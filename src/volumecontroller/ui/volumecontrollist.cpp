@@ -1,8 +1,18 @@
 #include "volumecontrollist.h"
+#include "volumecontroller/info/collation.h"
 #include "volumecontroller/info/processdata.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QPointer>
+#include <QScreen>
+#include <QSet>
+#include <QThreadPool>
 
 #include "volumecontroller/collections.h"
+#include "volumecontroller/keyeddiff.h"
+#include "volumecontroller/metrics.h"
 #include <volumecontroller/joiner.h>
 
 static std::vector<std::unique_ptr<SessionVolumeItem>>::iterator FindItem(std::vector<std::unique_ptr<SessionVolumeItem>> &items, const SessionVolumeItem &sessionVolume) {
@@ -11,18 +21,22 @@ static std::vector<std::unique_ptr<SessionVolumeItem>>::iterator FindItem(std::v
 	});
 }
 
+constexpr QSize programmIconSize = QSize(32, 32);
+
 constexpr auto sessionVolumeItemComparator = [](const SessionVolumeItem &a, const SessionVolumeItem &b) {
-	return a.identifier() < b.identifier();
+	return Collation::Less(a.sortKey(), b.sortKey());
 };
 
 constexpr auto sessionVolumeItemPtrComparator = [](const SessionVolumeItemPtr &a, const SessionVolumeItemPtr &b) {
 	return sessionVolumeItemComparator(*a, *b);
 };
 
-VolumeControlList::VolumeControlList(QWidget *parent, AudioSessionGroups &sessionGroups, const VolumeItemTheme &itemTheme, bool showInactive)
+VolumeControlList::VolumeControlList(QWidget *parent, AudioSessionGroups &sessionGroups, VolumeProfiles &profiles, const VolumeItemTheme &itemTheme, bool showInactive,
+												 bool lazy, const QByteArray &metricLabels, const SessionSnapshot *snapshot)
 	: QWidget(parent),
 	  layout(this),
 	  sessionGroups(sessionGroups),
+	  profiles(profiles),
 	  itemThemeRef(itemTheme),
 	  _showInactive(showInactive)
 {
@@ -45,13 +59,241 @@ VolumeControlList::VolumeControlList(QWidget *parent, AudioSessionGroups &sessio
 	layout.setAlignment(Qt::AlignTop);
 	layout.setContentsMargins(0, 0, 0, 0);
 
+	auto &metrics = Metrics::instance();
+	metrics.addGauge("volumecontroller_sessions", "Session items of the list", (metricLabels + ",state=\"listed\"").constData(), this, [this]() {
+		return qreal(volumeItems.size());
+	});
+	metrics.addGauge("volumecontroller_sessions", "Session items of the list", (metricLabels + ",state=\"hidden_inactive\"").constData(), this, [this]() {
+		return qreal(volumeItemsInactive.size());
+	});
+	metrics.addGauge("volumecontroller_rows", "Visible rows of the session list", metricLabels.constData(), this, [this]() {
+		return qreal(rowItems.size());
+	});
+	metrics.addGauge("volumecontroller_pid_groups", "Processes with audio sessions", metricLabels.constData(), this, [this]() {
+		return qreal(sessionGroups.groups().size());
+	});
+
+	if(snapshot && !snapshot->isEmpty() && qFuzzyCompare(snapshot->devicePixelRatio(), devicePixelRatioF())) {
+		restoreSnapshot(*snapshot);
+	} else if(lazy) {
+		for(auto &g : sessionGroups.groups())
+			resolveInBackground(*g);
+		if(pendingResolves == 0)
+			QTimer::singleShot(0, this, &VolumeControlList::populate);
+	} else {
+		populate();
+	}
+}
+
+void VolumeControlList::populate() {
+	if(populated)
+		return;
+
+	QElapsedTimer timer;
+	timer.start();
 	createItems();
+	populated = true;
+	qDebug() << "Created" << volumeItems.size() + volumeItemsInactive.size() << "session items in" << timer.nsecsElapsed() / 1000 << "us";
+	emit contentChanged();
+}
+
+void VolumeControlList::restoreSnapshot(const SessionSnapshot &snapshot) {
+	QElapsedTimer timer;
+	timer.start();
+
+	QSet<QString> matched;
+	// the image of a raster pixmap is shared, not converted
+	std::vector<std::pair<const AudioSessionPidGroup*, QImage>> restored;
+	for(auto &g : sessionGroups.groups()) {
+		const bool isSystemSound = g->isSystemSound();
+		QString executable = isSystemSound ? QString() : ProcessData::GetProcessPath(g->pid()).value_or(QString());
+		const auto *entry = isSystemSound || !executable.isEmpty() ? snapshot.find(VolumeProfiles::key(executable, isSystemSound)) : nullptr;
+		if(!entry) {
+			++reconcileStatistics.added;
+			continue;
+		}
+
+		std::optional<QIcon> icon;
+		if(!entry->icon.isNull())
+			icon = QIcon(entry->icon);
+		g->setInfoPtr(std::make_unique<ProgrammInformation>(entry->title, std::move(icon), std::move(executable)));
+		restored.emplace_back(g.get(), entry->icon.toImage());
+		matched.insert(entry->key);
+	}
+	reconcileStatistics.restored = int(restored.size());
+	reconcileStatistics.removed = snapshot.size() - matched.size();
+
+	// programs missing from the snapshot get their items once resolved in the background
+	populate();
+	qDebug() << "Restored" << reconcileStatistics.restored << "of" << snapshot.size() << "programs from the snapshot, list ready in"
+				<< timer.nsecsElapsed() / 1000 << "us";
+
+	reconcileTime.start();
+	pendingReconciles = int(restored.size());
+	for(auto &[group, icon] : restored)
+		reconcileInBackground(*group, std::move(icon));
+}
+
+// Runs on a worker, the icon of the snapshot is at the ratio of the first resolved image
+static bool SameProgram(const QString &title, const QImage &icon, const ProgrammSource &source) {
+	if(title != source.title || icon.isNull() != source.images.empty())
+		return false;
+	if(icon.isNull())
+		return true;
+	return icon.convertToFormat(QImage::Format_ARGB32) == source.images.front().convertToFormat(QImage::Format_ARGB32);
+}
+
+void VolumeControlList::onReconciled(DWORD pid, std::optional<ProgrammSource> &&update) {
+	--pendingReconciles;
+	auto it = sessionGroups.findPidGroup(pid);
+	if(update && it != sessionGroups.groups().end() && (*it)->infoPtr()) {
+		auto &group = **it;
+		group.setInfoPtr(std::make_unique<ProgrammInformation>(std::move(*update)));
+		qDebug() << "Snapshot of pid" << pid << "is outdated, title is now" << group.infoPtr()->title();
+		++reconcileStatistics.updated;
+		const auto updateItems = [&](std::vector<SessionVolumeItemPtr> &items) {
+			for(auto &item : items) {
+				if(item->control().pid() != pid)
+					continue;
+				item->setInfo(group.infoPtr()->icon(), group.infoPtr()->titleHandle());
+				indexItem(*item);
+			}
+		};
+		updateItems(volumeItems);
+		updateItems(volumeItemsInactive);
+		emit contentChanged();
+	}
+
+	if(pendingReconciles > 0)
+		return;
+	if(reconcileStatistics.updated > 0)
+		reconcileRows();
+	const auto &s = reconcileStatistics;
+	qDebug() << "Reconciled snapshot with the live programs:" << s.added << "added," << s.removed << "removed,"
+				<< s.updated << "of" << s.restored << "updated in" << reconcileTime.elapsed() << "ms";
+}
+
+void VolumeControlList::writeSnapshot(SessionSnapshot &snapshot) const {
+	std::vector<SessionSnapshot::Entry> entries;
+	QSet<QString> written;
+	const auto write = [&](const std::vector<SessionVolumeItemPtr> &items) {
+		for(const auto &item : items) {
+			const auto pid = item->control().pid();
+			if(!pid)
+				continue;
+			auto it = sessionGroups.findPidGroup(*pid);
+			if(it == sessionGroups.groups().end() || !(*it)->infoPtr())
+				continue;
+			const auto &info = *(*it)->infoPtr();
+			const QString key = VolumeProfiles::key(info.executable(), (*it)->isSystemSound());
+			if(key.isEmpty() || written.contains(key))
+				continue;
+			written.insert(key);
+			entries.push_back({key, info.title(), info.icon() ? info.icon()->pixmap(programmIconSize) : QPixmap()});
+		}
+	};
+	write(volumeItems);
+	write(volumeItemsInactive);
+	snapshot.setEntries(std::move(entries));
+}
+
+std::vector<qreal> VolumeControlList::iconDevicePixelRatios() const {
+	std::vector<qreal> ratios{devicePixelRatioF()};
+	for(const QScreen *screen : QGuiApplication::screens()) {
+		const qreal ratio = screen->devicePixelRatio();
+		if(std::none_of(ratios.begin(), ratios.end(), [=](qreal r) { return qFuzzyCompare(r, ratio); }))
+			ratios.push_back(ratio);
+	}
+	return ratios;
+}
+
+// Runs on a worker of the thread pool
+static ProgrammSource ResolveProgram(DWORD pid, bool isSystemSound, const std::vector<qreal> &devicePixelRatios) {
+	const bool comInitialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED));
+	auto source = ProgrammInformation::resolve(pid, isSystemSound, programmIconSize, devicePixelRatios);
+	if(comInitialized)
+		CoUninitialize();
+	return source;
+}
+
+void VolumeControlList::resolveInBackground(const AudioSessionPidGroup &group) {
+	if(group.infoPtr() || !resolvingPids.insert(group.pid()).second)
+		return;
+	++pendingResolves;
+	QPointer<VolumeControlList> receiver(this);
+	QThreadPool::globalInstance()->start([receiver, pid = group.pid(), isSystemSound = group.isSystemSound(), ratios = iconDevicePixelRatios()]() {
+		auto source = ResolveProgram(pid, isSystemSound, ratios);
+		if(receiver) {
+			QMetaObject::invokeMethod(receiver.data(), [receiver, pid, source = std::move(source)]() mutable {
+				receiver->onResolved(pid, std::move(source));
+			}, Qt::QueuedConnection);
+		}
+	});
+}
+
+void VolumeControlList::reconcileInBackground(const AudioSessionPidGroup &group, QImage icon) {
+	QPointer<VolumeControlList> receiver(this);
+	QThreadPool::globalInstance()->start([receiver, pid = group.pid(), isSystemSound = group.isSystemSound(), title = group.infoPtr()->title(),
+													 icon = std::move(icon), ratios = iconDevicePixelRatios()]() {
+		auto source = ResolveProgram(pid, isSystemSound, ratios);
+		// compared here, converting the icons is too slow for the GUI thread
+		std::optional<ProgrammSource> update;
+		if(!SameProgram(title, icon, source))
+			update = std::move(source);
+		if(receiver) {
+			QMetaObject::invokeMethod(receiver.data(), [receiver, pid, update = std::move(update)]() mutable {
+				receiver->onReconciled(pid, std::move(update));
+			}, Qt::QueuedConnection);
+		}
+	});
 }
 
-void VolumeControlList::updatePeaks() {
-	std::for_each(volumeItems.begin(), volumeItems.end(), [](std::unique_ptr<SessionVolumeItem> &item) {
-		item->updatePeak();
+void VolumeControlList::onResolved(DWORD pid, ProgrammSource &&source) {
+	--pendingResolves;
+	resolvingPids.erase(pid);
+	auto it = sessionGroups.findPidGroup(pid);
+	if(it == sessionGroups.groups().end())
+		return;
+	auto &group = **it;
+	if(!group.infoPtr())
+		group.setInfoPtr(std::make_unique<ProgrammInformation>(std::move(source)));
+	if(!populated) {
+		if(pendingResolves == 0)
+			populate();
+		return;
+	}
+
+	// sessions that came in after populate() or were listed before their program was known
+	const auto ready = std::stable_partition(unresolvedSessions.begin(), unresolvedSessions.end(), [pid](AudioSession *session) {
+		return session->pid() != pid;
 	});
+	if(ready == unresolvedSessions.end())
+		return;
+	batching = true;
+	for(auto session = ready; session != unresolvedSessions.end(); ++session) {
+		// expired while its program was resolved
+		if((*session)->state().value_or(AudioSession::State::Expired) == AudioSession::State::Expired)
+			continue;
+		if(deferUpdates()) {
+			pendingSessions.emplace_back(*session, &group);
+			++deferredEvents;
+		} else {
+			addNewItem(createItem(**session, group));
+		}
+	}
+	batching = false;
+	unresolvedSessions.erase(ready, unresolvedSessions.end());
+	if(!deferUpdates())
+		reconcileRows();
+	emit contentChanged();
+}
+
+void VolumeControlList::updatePeaks(qreal dt) {
+	static Counter &meterUpdates = Metrics::instance().counter("volumecontroller_meter_updates_total", "Peak meters of session rows advanced");
+	meterUpdates.add(rowItems.size());
+	// hidden items need no meter
+	for(auto item : rowItems)
+		item->updatePeak(dt);
 }
 
 void VolumeControlList::addSession(std::unique_ptr<AudioSession> &&sessionPtr) {
@@ -63,21 +305,35 @@ void VolumeControlList::addSession(std::unique_ptr<AudioSession> &&sessionPtr) {
 	if(!pidOpt)
 		return;
 
-	auto cx = 32 * logicalDpiX() / 96.0;
-	auto cy = 32 * logicalDpiY() / 96.0;
-
 	auto &pidGroup = sessionGroups.findPidGroupOrCreate(*pidOpt);
-	if(!pidGroup.infoPtr())
-		pidGroup.setInfoPtr(ProgrammInformation::forProcess(pidGroup.pid(), pidGroup.isSystemSound(), QSize(cx, cy)));
 
-	GUID guid;
-	if(FAILED(session.control().GetGroupingParam(&guid)))
+	const auto guid = session.groupingParam();
+	if(!guid)
 		return;
 
-	auto &group = pidGroup.findGroupOrCreate(guid);
+	auto &group = pidGroup.findGroupOrCreate(*guid);
 	group.insert(std::move(sessionPtr));
 
-	addNewItem(createItem(session, pidGroup));
+	// picked up by populate()
+	if(!populated) {
+		resolveInBackground(pidGroup);
+		return;
+	}
+
+	// added by onResolved()
+	if(!pidGroup.infoPtr()) {
+		unresolvedSessions.push_back(&session);
+		resolveInBackground(pidGroup);
+		return;
+	}
+
+	if(deferUpdates()) {
+		pendingSessions.emplace_back(&session, &pidGroup);
+		++deferredEvents;
+	} else {
+		addNewItem(createItem(session, pidGroup));
+	}
+	emit contentChanged();
 }
 
 void VolumeControlList::addItem(QGridLayout &layout, VolumeItemBase &item, int row) {
@@ -105,32 +361,42 @@ void VolumeControlList::setShowInactive(bool value) {
 
 		for(auto &item : volumeItemsInactive) {
 			item->show();
-			addItem(layout, *item, int(volumeItems.size()));
 			volumeItems.emplace_back(std::move(item));
 		}
 		volumeItemsInactive.clear();
-
-		sortItems();
 	} else {
-		std::vector<int> deletedRows;
-		for(auto it = volumeItems.begin(); it != volumeItems.end(); ++it) {
-			auto &item = *it;
-			const auto state = item->control().state();
-			if(state != AudioSession::State::Inactive)
-				continue;
-			item->hide();
-			deletedRows.emplace_back(int(std::distance(volumeItems.begin(), it)));
-			volumeItemsInactive.emplace_back(std::move(item));
-		}
-		qDebug().nospace() << "Hiding inactive items " << Joiner(deletedRows, ", ", [](auto &str, const auto &value) {
-			str << value;
+		const auto it = std::stable_partition(volumeItems.begin(), volumeItems.end(), [](const SessionVolumeItemPtr &item) {
+			return item->control().state() != AudioSession::State::Inactive;
 		});
+		qDebug().nospace() << "Hiding " << std::distance(it, volumeItems.end()) << " inactive items";
+		for(auto i = it; i != volumeItems.end(); ++i) {
+			(*i)->hide();
+			volumeItemsInactive.emplace_back(std::move(*i));
+		}
+		volumeItems.erase(it, volumeItems.end());
+	}
+	reconcileRows();
+	emit contentChanged();
+}
 
-		layout.removeRows(deletedRows);
+std::vector<SessionVolumeItem*> VolumeControlList::findItems(const QString &name) {
+	populate();
+	const QString executableName = name.endsWith(".exe", Qt::CaseInsensitive) ? name : name + ".exe";
+	const auto matches = [&](const SessionVolumeItem &item) {
+		return item.identifier().compare(name, Qt::CaseInsensitive) == 0
+			|| QFileInfo(item.executable()).fileName().compare(executableName, Qt::CaseInsensitive) == 0;
+	};
 
-		const auto it = RemoveIndices(volumeItems.begin(), volumeItems.end(), deletedRows.cbegin(), deletedRows.cend());
-		volumeItems.erase(it, volumeItems.end());
+	std::vector<SessionVolumeItem*> result;
+	for(auto &item : volumeItems) {
+		if(matches(*item))
+			result.push_back(item.get());
 	}
+	for(auto &item : volumeItemsInactive) {
+		if(matches(*item))
+			result.push_back(item.get());
+	}
+	return result;
 }
 
 void VolumeControlList::changeTheme(const VolumeItemTheme &item) {
@@ -144,35 +410,118 @@ void VolumeControlList::changeTheme(const VolumeItemTheme &item) {
 }
 
 std::unique_ptr<SessionVolumeItem> VolumeControlList::createItem(AudioSession &sessionControl, const AudioSessionPidGroup &group) {
-	std::unique_ptr<SessionVolumeItem> item = std::make_unique<SessionVolumeItem>(this, sessionControl, itemTheme());
+	std::unique_ptr<SessionVolumeItem> item = std::make_unique<SessionVolumeItem>(this, sessionControl, nextOrdinal++, itemTheme());
 
 	Q_ASSERT(group.infoPtr());
-	item->setInfo(group.infoPtr()->icon(), group.infoPtr()->title());
+	item->setInfo(group.infoPtr()->icon(), group.infoPtr()->titleHandle());
+	item->setExecutable(group.infoPtr()->executable());
 
-	connect(&sessionControl, &AudioSession::volumeChanged, item.get(), &SessionVolumeItem::setVolumeFAndMute, Qt::ConnectionType::QueuedConnection);
-	connect(&sessionControl, &AudioSession::stateChanged, item.get(), [this, &control = *item](int state) {
+	item->observeSession([this, &control = *item](float volume, bool mute) {
+		onSessionVolumeChanged(control, volume, mute);
+	}, [this, &control = *item](int state) {
 		qDebug() << "Session state of"  << control.identifier() << "changed" << state;
-		if(state == AudioSessionState::AudioSessionStateActive)
-			onSessionActive(control);
-		if(state == AudioSessionState::AudioSessionStateInactive)
-			onSessionInactive(control);
-		else if(state == AudioSessionState::AudioSessionStateExpired)
-			onSessionExpire(control);
-	}, Qt::ConnectionType::QueuedConnection);
+		onSessionStateChanged(control, state);
+	});
+	// only what the user sets is remembered, not what programs or other mixers do
+	const auto profileKey = VolumeProfiles::key(group.infoPtr()->executable(), group.isSystemSound());
+	connect(item.get(), &VolumeItemBase::volumeEdited, this, [this, profileKey, &control = *item](int volume) {
+		profiles.store(profileKey, VolumeProfile{volume / 100.0f, control.muted()});
+	});
+	connect(item.get(), &VolumeItemBase::muteEdited, this, [this, profileKey, &control = *item](bool mute) {
+		profiles.store(profileKey, VolumeProfile{control.volumeSlider()->value() / 100.0f, mute});
+	});
 
+	indexItem(*item);
 	qDebug() << "Created session" << item->identifier() << "pid" << group.pid();
 	return item;
 }
 
-void VolumeControlList::createItems() {
-	auto cx = 32 * logicalDpiX() / 96.0;
-	auto cy = 32 * logicalDpiY() / 96.0;
+void VolumeControlList::indexItem(SessionVolumeItem &item) {
+	filterIndex.insert(&item, item.identifier() + '\n' + QFileInfo(item.executable()).fileName());
+}
+
+void VolumeControlList::setGroupByExecutable(bool value) {
+	if(value == _groupByExecutable)
+		return;
+	_groupByExecutable = value;
+	qDebug() << "Group by executable changed to" << value;
+	if(!_groupByExecutable) {
+		for(auto &item : volumeItems)
+			item->setGroup(nullptr);
+		executableGroups.clear();
+	}
+	reconcileRows();
+	emit contentChanged();
+}
 
-	std::for_each(sessionGroups.groups().begin(), sessionGroups.groups().end(), [&](std::unique_ptr<AudioSessionPidGroup> &g) {
-		g->setInfoPtr(ProgrammInformation::forProcess(g->pid(), g->isSystemSound(), QSize(cx, cy)));
+void VolumeControlList::groupRows(std::vector<SessionVolumeItem*> &target) {
+	std::unordered_map<QString, std::vector<SessionVolumeItem*>> members;
+	const auto keyOf = [](const SessionVolumeItem &item) {
+		return VolumeProfiles::key(item.executable(), item.control().isSystemSound());
+	};
+	// target is sorted, so the first member of every executable leads it
+	const size_t sessions = target.size();
+	const auto it = std::remove_if(target.begin(), target.end(), [&](SessionVolumeItem *item) {
+		const QString key = keyOf(*item);
+		if(key.isEmpty())
+			return false;
+		auto &group = members[key];
+		group.push_back(item);
+		if(group.size() == 1)
+			return false;
+		item->setGroup(nullptr);
+		item->hide();
+		return true;
 	});
+	target.erase(it, target.end());
+
+	decltype(executableGroups) groups;
+	for(auto &[key, items] : members) {
+		if(items.size() == 1) {
+			items.front()->setGroup(nullptr);
+			continue;
+		}
+		auto existing = executableGroups.find(key);
+		auto group = existing != executableGroups.end() ? std::move(existing->second) : std::make_shared<ExecutableGroup>();
+		std::vector<AudioSession*> controls(items.size());
+		std::transform(items.begin(), items.end(), controls.begin(), [](SessionVolumeItem *item) {
+			return &item->control();
+		});
+		group->setMembers(std::move(controls));
+		items.front()->setGroup(group);
+		groups.emplace(key, std::move(group));
+	}
+	executableGroups = std::move(groups);
+	qDebug().nospace() << "Grouped " << sessions << " sessions into " << target.size() << " rows, " << executableGroups.size()
+							 << " executables with several sessions";
+}
+
+void VolumeControlList::setFilter(const QString &text) {
+	if(text == filterText)
+		return;
+	QElapsedTimer timer;
+	timer.start();
+	filterText = text;
+	reconcileRows();
+	qDebug().nospace() << "Filtered " << filterIndex.size() << " items by " << text << " to " << rowItems.size() << " rows in "
+							 << timer.nsecsElapsed() / 1000 << " us";
+	emit contentChanged();
+}
 
+void VolumeControlList::createItems() {
 	for(auto &g : sessionGroups.groups()) {
+		// added by onResolved()
+		if(!g->infoPtr()) {
+			for(auto &gl : g->groups()) {
+				for(auto &sessionControl : gl->members()) {
+					if(sessionControl->state() != AudioSession::State::Expired)
+						unresolvedSessions.push_back(sessionControl.get());
+				}
+			}
+			resolveInBackground(*g);
+			continue;
+		}
+
 		for(auto &gl : g->groups()) {
 			for(auto &sessionControl : gl->members()) {
 				const auto state = sessionControl->state();
@@ -194,18 +543,16 @@ void VolumeControlList::createItems() {
 		}
 	}
 
-	for(size_t i = 0; i < volumeItems.size(); ++i) {
-		addItem(layout, *volumeItems[i], int(i));
-	}
-
-	sortItems();
+	reconcileRows();
 }
 
 void VolumeControlList::addNewItem(std::unique_ptr<SessionVolumeItem> &&item) {
 	const auto state = item->control().state().value_or(AudioSession::State::Expired);
 	qDebug() << "Item" << item->identifier() << "is" << ToString(state);
-	if(state == AudioSession::State::Expired)
+	if(state == AudioSession::State::Expired) {
+		filterIndex.remove(item.get());
 		return;
+	}
 
 	if(state == AudioSession::State::Active || showInactive()) {
 		insertActiveItem(std::move(item));
@@ -219,33 +566,137 @@ void VolumeControlList::addNewItem(std::unique_ptr<SessionVolumeItem> &&item) {
 std::unique_ptr<SessionVolumeItem> VolumeControlList::removeActiveItem(std::vector<std::unique_ptr<SessionVolumeItem>>::iterator it) {
 	auto item = std::move(*it);
 	qDebug() << "Removing active item" << item->identifier();
-	layout.removeRow(std::distance(volumeItems.begin(), it));
 	volumeItems.erase(it);
 	return item;
 }
 
 void VolumeControlList::insertActiveItem(std::unique_ptr<SessionVolumeItem> &&item) {
 	qDebug() << "Inserting active item" << item->identifier();
-	addItem(layout, *item, int(volumeItems.size()));
 	volumeItems.emplace_back(std::move(item));
-	sortItems();
+	if(!batching)
+		reconcileRows();
 }
 
-void VolumeControlList::sortItems() {
-	Q_ASSERT(int(volumeItems.size()) == layout.rowCount());
-	auto perm = CreateSortedPermutation<int>(volumeItems.begin(), volumeItems.end(), sessionVolumeItemPtrComparator);
-	ApplyPermutation(perm.begin(), perm.end(), [&](const size_t a, const size_t b) {
-		std::swap(volumeItems[a], volumeItems[b]);
-		layout.swapRows(int(a), int(b));
-	});
-
-	Q_ASSERT(std::is_sorted(volumeItems.begin(), volumeItems.end(), sessionVolumeItemPtrComparator));
-	Q_ASSERT(int(volumeItems.size()) == layout.rowCount());
+void VolumeControlList::reconcileRows() {
+	Q_ASSERT(int(rowItems.size()) == layout.rowCount());
+	QElapsedTimer timer;
+	timer.start();
+	std::stable_sort(volumeItems.begin(), volumeItems.end(), sessionVolumeItemPtrComparator);
+	std::optional<TrigramIndex<SessionVolumeItem*>::Result> matches;
+	if(!filterText.isEmpty())
+		matches = filterIndex.find(filterText);
+	std::vector<SessionVolumeItem*> target;
+	target.reserve(volumeItems.size());
+	for(auto &item : volumeItems) {
+		if(matches && matches->count(item.get()) == 0) {
+			item->hide();
+			continue;
+		}
+		target.push_back(item.get());
+	}
+	if(_groupByExecutable)
+		groupRows(target);
+
+	const auto diff = ComputeKeyedDiff(rowItems, target);
+	if(!diff.empty()) {
+		layout.applyDiff(diff, [&](size_t row) {
+			auto &item = *target[row];
+			return std::vector<QWidget*>{item.descriptionButton(), item.volumeSlider(), item.volumeLabel()};
+		});
+	}
+	// rows that were filtered out before
+	for(const size_t row : diff.inserted)
+		target[row]->show();
+	rowItems = std::move(target);
+	retiredItems.clear();
+
+	Q_ASSERT(int(rowItems.size()) == layout.rowCount());
+	qDebug().nospace() << "Reconciled rows, " << diff.removed.size() << " removed, " << diff.moved.size() << " moved, "
+							 << diff.inserted.size() << " inserted in " << timer.nsecsElapsed() / 1000 << " us";
 	qDebug().noquote().nospace() << "Sorted items are: " << Join(volumeItems, ", ", [](auto &str, const auto &item) {
 		str << item->identifier();
 	});
 }
 
+void VolumeControlList::setDeferUpdates(bool value) {
+	if(_deferUpdates == value)
+		return;
+	_deferUpdates = value;
+	if(!_deferUpdates)
+		applyPendingChanges();
+}
+
+void VolumeControlList::applyPendingChanges() {
+	if(pendingVolumes.empty() && pendingStates.empty() && pendingSessions.empty())
+		return;
+
+	QElapsedTimer timer;
+	timer.start();
+	const size_t appliedChanges = pendingVolumes.size() + pendingStates.size() + pendingSessions.size();
+	const bool rowsChanged = !pendingStates.empty() || !pendingSessions.empty();
+
+	setUpdatesEnabled(false);
+	batching = true;
+
+	// volumes first, expiring rows are destroyed by the state changes
+	for(const auto &[item, value] : pendingVolumes)
+		item->setVolumeFAndMute(value.volume, value.mute);
+	pendingVolumes.clear();
+
+	for(const auto &[item, state] : pendingStates)
+		onSessionStateChanged(*item, state);
+	pendingStates.clear();
+
+	for(const auto &[session, group] : pendingSessions)
+		addNewItem(createItem(*session, *group));
+	pendingSessions.clear();
+
+	if(rowsChanged)
+		reconcileRows();
+	batching = false;
+	setUpdatesEnabled(true);
+
+	totalDeferredEvents += deferredEvents;
+	totalAppliedChanges += appliedChanges;
+	static Counter &coalesced = Metrics::instance().counter("volumecontroller_events_coalesced_total",
+																			"Events folded into a later one instead of being handled", "type=\"deferred\"");
+	coalesced.add(deferredEvents - appliedChanges);
+	qDebug().nospace() << "Applied " << appliedChanges << " pending changes for " << deferredEvents << " deferred events in "
+							 << timer.nsecsElapsed() / 1000 << " us, avoided " << totalDeferredEvents - totalAppliedChanges
+							 << " of " << totalDeferredEvents << " widget updates so far";
+	deferredEvents = 0;
+	emit contentChanged();
+}
+
+void VolumeControlList::onSessionVolumeChanged(SessionVolumeItem &sessionVolume, float volume, bool mute) {
+	// values alone do not invalidate the prewarmed frame, they are applied when the window shows
+	if(deferUpdates()) {
+		pendingVolumes[&sessionVolume] = PendingVolume{volume, mute};
+		++deferredEvents;
+		return;
+	}
+	sessionVolume.setVolumeFAndMute(volume, mute);
+	emit contentChanged();
+}
+
+void VolumeControlList::onSessionStateChanged(SessionVolumeItem &sessionVolume, int state) {
+	if(deferUpdates() && !batching) {
+		pendingStates[&sessionVolume] = state;
+		++deferredEvents;
+		emit contentChanged();
+		return;
+	}
+
+	if(state == AudioSessionState::AudioSessionStateActive)
+		onSessionActive(sessionVolume);
+	if(state == AudioSessionState::AudioSessionStateInactive)
+		onSessionInactive(sessionVolume);
+	else if(state == AudioSessionState::AudioSessionStateExpired)
+		onSessionExpire(sessionVolume);
+	if(!batching)
+		emit contentChanged();
+}
+
 void VolumeControlList::onSessionActive(SessionVolumeItem &sessionVolume) {
 	if(showInactive()) {
 		qDebug() << "Show inactive activated, ignoring onSessionActive of" << sessionVolume.identifier();
@@ -285,6 +736,8 @@ void VolumeControlList::onSessionInactive(SessionVolumeItem &sessionVolume) {
 	qDebug() << "Hiding inactive item" << sessionVolume.identifier();
 	item->hide();
 	volumeItemsInactive.emplace_back(std::move(item));
+	if(!batching)
+		reconcileRows();
 }
 
 void VolumeControlList::onSessionExpire(SessionVolumeItem &sessionVolume) {
@@ -299,9 +752,14 @@ void VolumeControlList::onSessionExpire(SessionVolumeItem &sessionVolume) {
 
 		auto &item = *it;
 		qDebug() << "Removing expired item" << item->identifier();
+		filterIndex.remove(item.get());
 		volumeItemsInactive.erase(it);
 	} else {
 		auto item = removeActiveItem(it);
 		qDebug() << "Removing expired item" << item->identifier();
+		filterIndex.remove(item.get());
+		retiredItems.emplace_back(std::move(item));
+		if(!batching)
+			reconcileRows();
 	}
 }
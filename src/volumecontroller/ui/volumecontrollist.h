@@ -1,13 +1,21 @@
 #ifndef VOLUMECONTROLLIST_H
 #define VOLUMECONTROLLIST_H
 
+#include <QElapsedTimer>
 #include <QGridLayout>
+#include <QTimer>
 #include <QWidget>
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include "volumecontroller/audio/audiosessions.h"
+#include "volumecontroller/audio/volumeprofiles.h"
+#include "volumecontroller/info/sessionsnapshot.h"
 #include "volumecontroller/ui/volumelistitem.h"
 #include "volumecontroller/ui/gridlayout.h"
 #include "volumecontroller/ui/theme.h"
+#include "volumecontroller/trigramindex.h"
 
 using SessionVolumeItemPtr = std::unique_ptr<SessionVolumeItem>;
 
@@ -16,9 +24,19 @@ class VolumeControlList : public QWidget
 	Q_OBJECT
 
 public:
-	VolumeControlList(QWidget *parent, AudioSessionGroups &sessionGroups, const VolumeItemTheme &item, bool showInactive);
+	// A lazy list resolves the programs on the thread pool and creates its items once done or on populate().
+	// With a snapshot the items are created right away from it and reconciled with the live programs resolved in the background.
+	// Programs are never resolved on the GUI thread, items of a program still resolving are added once it is known.
+	// metricLabels tell the metrics of lists of different devices apart, like device="...".
+	VolumeControlList(QWidget *parent, AudioSessionGroups &sessionGroups, VolumeProfiles &profiles, const VolumeItemTheme &item, bool showInactive,
+							bool lazy, const QByteArray &metricLabels, const SessionSnapshot *snapshot = nullptr);
+
+	void populate();
+	bool isPopulated() const noexcept { return populated; }
+
+	void writeSnapshot(SessionSnapshot &snapshot) const;
 
-	void updatePeaks();
+	void updatePeaks(qreal dt);
 
 	void addSession(std::unique_ptr<AudioSession> &&ptr);
 
@@ -33,9 +51,41 @@ public:
 
 	const VolumeItemTheme &itemTheme() const noexcept { return itemThemeRef.get(); }
 
+	// Items whose title or executable file name match name case insensitively, the .exe suffix is optional
+	std::vector<SessionVolumeItem*> findItems(const QString &name);
+
+	// Shows one row per executable, its volume and mute apply to the sessions of all its processes
+	void setGroupByExecutable(bool value);
+	bool groupByExecutable() const noexcept { return _groupByExecutable; }
+
+	// Shows only the items whose title or executable file name contain text, an empty text shows all
+	void setFilter(const QString &text);
+	const QString &filter() const noexcept { return filterText; }
+
+	// While deferring, session events only update a pending delta which is applied in one batch
+	void setDeferUpdates(bool value);
+	bool deferUpdates() const noexcept { return _deferUpdates; }
+	size_t pendingChangeCount() const noexcept { return pendingVolumes.size() + pendingStates.size() + pendingSessions.size(); }
+	size_t rowCount() const noexcept { return rowItems.size(); }
+	void applyPendingChanges();
+
+signals:
+	// Emitted whenever rows or their values changed, deferred value changes only once applied
+	void contentChanged();
+
 private:
 	std::unique_ptr<SessionVolumeItem> createItem(AudioSession &sessionControl, const AudioSessionPidGroup &group);
 	void createItems();
+	std::vector<qreal> iconDevicePixelRatios() const;
+	// Resolves the program of a group without one on the thread pool, once per pid, and hands it to onResolved()
+	void resolveInBackground(const AudioSessionPidGroup &group);
+	void onResolved(DWORD pid, ProgrammSource &&source);
+	void restoreSnapshot(const SessionSnapshot &snapshot);
+	// Resolves the program of a restored group and compares it with the snapshot on the thread pool,
+	// onReconciled() only gets the program if it changed
+	void reconcileInBackground(const AudioSessionPidGroup &group, QImage icon);
+	void onReconciled(DWORD pid, std::optional<ProgrammSource> &&update);
+	void indexItem(SessionVolumeItem &item);
 
 	void addNewItem(std::unique_ptr<SessionVolumeItem> &&item);
 	void insertActiveItem(std::unique_ptr<SessionVolumeItem> &&item);
@@ -45,7 +95,13 @@ private:
 //	void insertRow(int row, SessionVolumeItem &source);
 //	void fillGap(int row);
 
-	void sortItems();
+	// Sorts volumeItems and brings the layout rows in line with them in one pass
+	void reconcileRows();
+	// Keeps the first item of every executable in target and binds it to the executable's group
+	void groupRows(std::vector<SessionVolumeItem*> &target);
+
+	void onSessionVolumeChanged(SessionVolumeItem &sessionVolume, float volume, bool mute);
+	void onSessionStateChanged(SessionVolumeItem &sessionVolume, int state);
 
 	void onSessionActive(SessionVolumeItem &sessionVolume);
 	void onSessionInactive(SessionVolumeItem &sessionVolume);
@@ -53,11 +109,50 @@ private:
 
 	GridLayout layout;
 	AudioSessionGroups &sessionGroups;
+	VolumeProfiles &profiles;
 	std::vector<SessionVolumeItemPtr> volumeItems;
 	std::vector<SessionVolumeItemPtr> volumeItemsInactive;
+	// item shown in every layout row, and removed items kept alive until their row is gone
+	std::vector<SessionVolumeItem*> rowItems;
+	std::vector<SessionVolumeItemPtr> retiredItems;
+	TrigramIndex<SessionVolumeItem*> filterIndex;
+	QString filterText;
+	bool _groupByExecutable = false;
+	std::unordered_map<QString, std::shared_ptr<ExecutableGroup>> executableGroups;
 
 	bool _showInactive = false;
+	bool populated = false;
+	int pendingResolves = 0;
+	std::unordered_set<DWORD> resolvingPids;
+	// sessions waiting for the program of their process
+	std::vector<AudioSession *> unresolvedSessions;
+	quint32 nextOrdinal = 0;
+
+	struct ReconcileStatistics {
+		int restored = 0;
+		int added = 0;
+		int removed = 0;
+		int updated = 0;
+	};
+
+	int pendingReconciles = 0;
+	QElapsedTimer reconcileTime;
+	ReconcileStatistics reconcileStatistics;
 	std::reference_wrapper<const VolumeItemTheme> itemThemeRef;
+
+	struct PendingVolume {
+		float volume;
+		bool mute;
+	};
+
+	bool _deferUpdates = false;
+	bool batching = false;
+	std::unordered_map<SessionVolumeItem *, PendingVolume> pendingVolumes;
+	std::unordered_map<SessionVolumeItem *, int> pendingStates;
+	std::vector<std::pair<AudioSession *, const AudioSessionPidGroup *>> pendingSessions;
+	size_t deferredEvents = 0;
+	size_t totalDeferredEvents = 0;
+	size_t totalAppliedChanges = 0;
 };
 
 #endif // VOLUMECONTROLLIST_H
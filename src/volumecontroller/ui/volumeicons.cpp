@@ -1,6 +1,8 @@
 #include "volumeicons.h"
 #include <QPainter>
 
+#include <functional>
+
 const QChar VolumeIcons::Mute = L'\uE74F';
 const QChar VolumeIcons::Volume1 = L'\uE993';
 const QChar VolumeIcons::Volume2 = L'\uE994';
@@ -8,6 +10,9 @@ const QChar VolumeIcons::Volume3 = L'\uE995';
 
 const QFont VolumeIcons::IconFont = QFont("Segoe MDL2 Assets", 22);
 
+// glyph height relative to the icon size, 22pt at 96 dpi in a 32px icon
+constexpr qreal iconFontScale = 22.0 * 96.0 / 72.0 / 32.0;
+
 const QColor VolumeIcons::Gray = QColor::fromRgb(55, 55, 55);
 const QColor VolumeIcons::LightGray = QColor::fromRgb(127, 127, 127);
 
@@ -18,30 +23,38 @@ void DrawVolumeIcon(QPainter &painter, QChar c, const QRect &rect, QColor foregr
 	painter.drawText(rect, Qt::AlignCenter, c);
 }
 
-VolumeIcons::VolumeIcons(QSize size, const IconTheme &theme) {
-	QImage image(size, QImage::Format::Format_RGBA8888);
-	const auto rect = QRect(0, 0, size.width(), size.height());
-
-	QPainter painter(&image);
-	painter.setFont(IconFont);
-
-	image.fill(0);
-	painter.setPen(theme.foreground);
-	painter.drawText(rect, Qt::AlignCenter, Mute);
-	icons[0] = std::make_unique<QIcon>(QPixmap::fromImage(image));
-
-	image.fill(0);
-	DrawVolumeIcon(painter, Volume1, rect, theme.foreground, theme.background);
-	icons[1] = std::make_unique<QIcon>(QPixmap::fromImage(image));
+VolumeIcons::VolumeIcons(QSize size, const IconTheme &theme, qreal devicePixelRatio) {
+	QFont font = IconFont;
+	font.setPixelSize(qRound(size.height() * iconFontScale));
+	const auto rect = QRect(QPoint(0, 0), size);
 
-	image.fill(0);
-	DrawVolumeIcon(painter, Volume2, rect, theme.foreground, theme.background);
-	icons[2] = std::make_unique<QIcon>(QPixmap::fromImage(image));
+	// every icon is painted straight into the image its pixmap is made from
+	const auto render = [&](const std::function<void(QPainter&)> &draw) {
+		QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+		image.setDevicePixelRatio(devicePixelRatio);
+		image.fill(Qt::transparent);
+		{
+			QPainter painter(&image);
+			painter.setFont(font);
+			draw(painter);
+		}
+		return std::make_unique<QIcon>(QPixmap::fromImage(std::move(image)));
+	};
 
-	image.fill(0);
-	painter.setPen(theme.foreground);
-	painter.drawText(rect, Qt::AlignCenter, Volume3);
-	icons[3] = std::make_unique<QIcon>(QPixmap::fromImage(image));
+	icons[0] = render([&](QPainter &painter) {
+		painter.setPen(theme.foreground);
+		painter.drawText(rect, Qt::AlignCenter, Mute);
+	});
+	icons[1] = render([&](QPainter &painter) {
+		DrawVolumeIcon(painter, Volume1, rect, theme.foreground, theme.background);
+	});
+	icons[2] = render([&](QPainter &painter) {
+		DrawVolumeIcon(painter, Volume2, rect, theme.foreground, theme.background);
+	});
+	icons[3] = render([&](QPainter &painter) {
+		painter.setPen(theme.foreground);
+		painter.drawText(rect, Qt::AlignCenter, Volume3);
+	});
 }
 
 const QIcon &VolumeIcons::selectIcon(int volume) const {
@@ -19,7 +19,7 @@ public:
 	static const QColor LightGray;
 
 	VolumeIcons() = default;
-	VolumeIcons(QSize size, const IconTheme &theme);
+	VolumeIcons(QSize size, const IconTheme &theme, qreal devicePixelRatio = 1.0);
 
 	const QIcon &selectIcon(int volume) const;
 
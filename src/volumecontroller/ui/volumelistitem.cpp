@@ -1,5 +1,6 @@
 #include "volumecontroller.h"
 #include "volumelistitem.h"
+#include "volumecontroller/info/collation.h"
 #include <QApplication>
 #include <QDebug>
 #include <QGraphicsScene>
@@ -7,6 +8,8 @@
 #include <QPainter>
 #include <QStyleOptionSlider>
 
+#include <algorithm>
+
 PeakSlider::PeakSlider(QWidget *parent, const PeakSliderTheme &theme) : QSlider(parent), _theme(&theme) {}
 
 void PeakSlider::paintEvent(QPaintEvent *ev) {
@@ -44,7 +47,7 @@ void PeakSlider::setPeakValue(int value) {
 	if(_peakValue == value)
 		return;
 	_peakValue = value;
-	repaint();
+	update();
 }
 
 QWheelEvent CreateScrollEvent(QWheelEvent *e, QPoint angleDelta, Qt::KeyboardModifier modifiers) {
@@ -78,7 +81,11 @@ void PeakSlider::wheelEvent(QWheelEvent *e){
 	QSlider::wheelEvent(&event);
 }
 
-VolumeItemBase::VolumeItemBase(QWidget *parent, IAudioControl &ctrl, const VolumeItemTheme &theme) : QObject(parent), icon(nullptr), _control(ctrl) {
+// the three widgets of a row, shallow
+constexpr qint64 itemWidgetBytes = sizeof(QPushButton) + sizeof(PeakSlider) + sizeof(QLabel);
+
+VolumeItemBase::VolumeItemBase(QWidget *parent, IAudioControl &ctrl, const VolumeItemTheme &theme)
+	: QObject(parent), icon(nullptr), _control(ctrl), memory(MemoryCategory::Widgets, itemWidgetBytes, 3) {
 	_descriptionButton = new QPushButton(parent);
 	_descriptionButton->setFlat(true);
 	_descriptionButton->setCheckable(true);
@@ -100,15 +107,20 @@ VolumeItemBase::VolumeItemBase(QWidget *parent, IAudioControl &ctrl, const Volum
 
 	QObject::connect(_volumeSlider, &QSlider::valueChanged, [this](int value) {
 		setVolumeText(value);
-		volumeChangedEvent(value);
+		// values of the model are only shown, not written back
+		if(!applyingModelValues) {
+			volumeChangedEvent(value);
+			emit volumeEdited(value);
+		}
+		emit volumeChanged(value);
 	});
 
 	QObject::connect(_descriptionButton, &QPushButton::clicked, [this](bool checked) {
 		setMuted(checked);
 	});
 
-	setMuted(control().muted().value_or(true));
-	setVolume(control().volume().value_or(0.0f) * 100.0f);
+	setMutedInternal(control().muted().value_or(true));
+	setVolumeFAndMute(control().volume().value_or(0.0f), mutedValue);
 }
 
 VolumeItemBase::~VolumeItemBase() {
@@ -133,6 +145,8 @@ void VolumeItemBase::setVolumeSlider(int volume) {
 void VolumeItemBase::setMuted(bool muted) {
 	setMutedInternal(muted);
 	muteChangedEvent(muted);
+	emit muteEdited(muted);
+	emit muteChanged(muted);
 }
 
 void VolumeItemBase::setMutedInternal(bool muted) {
@@ -152,18 +166,23 @@ bool VolumeItemBase::muted() const {
 	return mutedValue;
 }
 
-void VolumeItemBase::updatePeak() {
-	int value = 0;
+// meter release in full scale per second, the attack is immediate
+constexpr float peakFalloff = 1.5f;
+
+void VolumeItemBase::updatePeak(qreal dt) {
+	float value = 0.0f;
 	if(!muted())
-		value = control().peakValue().value_or(0.0f) * 100.0f;
-	setPeak(value);
+		value = peakValue();
+	displayedPeak = std::max(value, displayedPeak - peakFalloff * float(dt));
+	setPeak(displayedPeak * 100.0f);
 }
 
 void VolumeItemBase::setIcon(const QIcon &icon) {
 	_descriptionButton->setIcon(icon);
 }
 
-void VolumeItemBase::setInfo(const std::optional<QIcon> &icon, const QString &identifier) {
+void VolumeItemBase::setInfo(const std::optional<QIcon> &icon, InternedString identifier) {
+	const bool identifierChanged = _identifier != identifier;
 	_identifier = identifier;
 	if(icon.has_value()) {
 		_descriptionButton->setToolTip(identifier);
@@ -171,6 +190,8 @@ void VolumeItemBase::setInfo(const std::optional<QIcon> &icon, const QString &id
 	} else {
 		_descriptionButton->setText(identifier);
 	}
+	if(identifierChanged)
+		identifierChangedEvent();
 }
 
 void VolumeItemBase::show() {
@@ -192,15 +213,11 @@ void VolumeItemBase::updateTheme(const VolumeItemTheme &theme) {
 void VolumeItemBase::volumeChangedEvent(const int value) {
 	if(!_control.setVolume(value / 100.0f))
 		qDebug() << "Failed to set volume for" << identifier();
-
-	emit volumeChanged(value);
 }
 
 void VolumeItemBase::muteChangedEvent(const bool mute) {
 	if(!_control.setMuted(mute))
 		qDebug() << "Failed to set mute for" << identifier();
-
-	emit muteChanged(mute);
 }
 
 void VolumeItemBase::setVolume(const int volume) {
@@ -209,15 +226,62 @@ void VolumeItemBase::setVolume(const int volume) {
 }
 
 void VolumeItemBase::setVolumeFAndMute(float volume, bool mute) {
+	applyingModelValues = true;
 	setVolume(volume * 100.0f);
-	setMuted(mute);
+	applyingModelValues = false;
+	if(mute == mutedValue)
+		return;
+	setMutedInternal(mute);
+	emit muteChanged(mute);
+}
+
+void VolumeItemBase::identifierChangedEvent() {}
+
+float VolumeItemBase::peakValue() const {
+	return control().peakValue().value_or(0.0f);
 }
 
-SessionVolumeItem::SessionVolumeItem(QWidget *parent, AudioSession &control, const VolumeItemTheme &theme) : VolumeItemBase(parent, control, theme), _control(control) {}
+SessionVolumeItem::SessionVolumeItem(QWidget *parent, AudioSession &control, quint32 ordinal, const VolumeItemTheme &theme)
+	: VolumeItemBase(parent, control, theme), _control(control), ordinal(ordinal) {
+	identifierChangedEvent();
+}
+
+void SessionVolumeItem::identifierChangedEvent() {
+	_sortKey = Collation::SortKey(identifier());
+	Collation::AppendTieBreaker(_sortKey, _control.pid().value_or(0));
+	Collation::AppendTieBreaker(_sortKey, ordinal);
+}
 
-DeviceVolumeItem::DeviceVolumeItem(QWidget *parent, DeviceAudioControl &control, const VolumeIcons &icons, const QString &deviceName, const VolumeItemTheme &theme) : VolumeItemBase(parent, control, theme), control(control), icons(icons) {
+void SessionVolumeItem::volumeChangedEvent(const int value) {
+	if(!_group) {
+		VolumeItemBase::volumeChangedEvent(value);
+		return;
+	}
+	_group->setVolume(value / 100.0f);
+}
+
+void SessionVolumeItem::muteChangedEvent(const bool mute) {
+	if(!_group) {
+		VolumeItemBase::muteChangedEvent(mute);
+		return;
+	}
+	_group->setMuted(mute);
+}
+
+float SessionVolumeItem::peakValue() const {
+	return _group ? _group->peakValue() : VolumeItemBase::peakValue();
+}
+
+void SessionVolumeItem::observeSession(std::function<void(float, bool)> volumeChanged, std::function<void(int)> stateChanged) {
+	volumeObserver.setCallback(std::move(volumeChanged));
+	volumeObserver.subscribe(_control.volumeObservers());
+	stateObserver.setCallback(std::move(stateChanged));
+	stateObserver.subscribe(_control.stateObservers());
+}
+
+DeviceVolumeItem::DeviceVolumeItem(QWidget *parent, DeviceAudioControl &control, const VolumeIcons &icons, const QString &deviceName, const VolumeItemTheme &theme) : VolumeItemBase(parent, control, theme), control(control), icons(&icons) {
 	const auto volume = control.volume().value_or(0.0f) * 100.0f;
-	setInfo(icons.selectIcon(volume), deviceName);
+	setInfo(icons.selectIcon(volume), InternedString(deviceName));
 }
 
 void DeviceVolumeItem::setVolumeFAndMute(float volume, bool muted) {
@@ -225,8 +289,13 @@ void DeviceVolumeItem::setVolumeFAndMute(float volume, bool muted) {
 	updateIcon(volume * 100.0f);
 }
 
-void DeviceVolumeItem::updateThemeAndIcon(const VolumeItemTheme &theme) {
+void DeviceVolumeItem::updateThemeAndIcon(const VolumeItemTheme &theme, const VolumeIcons &icons) {
 	VolumeItemBase::updateTheme(theme);
+	setIcons(icons);
+}
+
+void DeviceVolumeItem::setIcons(const VolumeIcons &icons) {
+	this->icons = &icons;
 	const auto volume = control.volume().value_or(0.0f) * 100.0f;
 	updateIcon(volume);
 }
@@ -237,5 +306,5 @@ void DeviceVolumeItem::volumeChangedEvent(const int value) {
 }
 
 void DeviceVolumeItem::updateIcon(const int volume) {
-	setIcon(icons.selectIcon(volume));
+	setIcon(icons->selectIcon(volume));
 }
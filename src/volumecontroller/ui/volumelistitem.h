@@ -1,6 +1,7 @@
 #ifndef VOLUMELISTITEM_H
 #define VOLUMELISTITEM_H
 #include "volumecontroller/audio/audiosessions.h"
+#include "volumecontroller/audio/executablegroup.h"
 
 #include <QWidget>
 #include <QLabel>
@@ -10,6 +11,8 @@
 #include <QPushButton>
 
 #include <volumecontroller/ui/theme.h>
+#include <volumecontroller/internedstring.h>
+#include <volumecontroller/memoryaccounting.h>
 
 class VolumeIcons;
 
@@ -59,15 +62,18 @@ public:
 
 	void setIcon(QPixmap bitmap);
 
+	// Like a change in the ui, written to the control or its group
 	void setVolume(int volume);
+	void setMuted(bool muted);
+	// Shows values reported by the control without writing them back
 	void setVolumeFAndMute(float volume, bool mute);
 
 	bool muted() const;
 
-	void updatePeak();
+	void updatePeak(qreal dt);
 
 	void setIcon(const QIcon &icon);
-	void setInfo(const std::optional<QIcon> &icon, const QString &identifier);
+	void setInfo(const std::optional<QIcon> &icon, InternedString identifier);
 
 	const IAudioControl &control() const { return _control; }
 
@@ -75,6 +81,7 @@ public:
 	void hide();
 
 	const QString &identifier() const { return _identifier; }
+	InternedString identifierHandle() const { return _identifier; }
 
 	QPushButton *descriptionButton() { return _descriptionButton; }
 	PeakSlider *volumeSlider() { return _volumeSlider; }
@@ -83,11 +90,13 @@ public:
 	void updateTheme(const VolumeItemTheme &theme);
 
 protected:
-	void setMuted(bool muted);
 	void setPeak(int volume);
 
+	// Write a change made in the ui to the backend
 	virtual void volumeChangedEvent(int value);
 	virtual void muteChangedEvent(bool mute);
+	virtual void identifierChangedEvent();
+	virtual float peakValue() const;
 
 	void setVolumeText(int volume);
 	void setVolumeSlider(int volume);
@@ -96,31 +105,66 @@ protected:
 	void setVolumeSliderNoEvent(int volume);
 
 signals:
+	// Any change of the shown values
 	void volumeChanged(int value);
 	void muteChanged(bool mute);
+	// Changes made in the ui or with setVolume and setMuted, written to the backend
+	void volumeEdited(int value);
+	void muteEdited(bool mute);
 
 private:
 	void setMutedInternal(bool muted);
 	void setVolumeInternal(int volume);
 
-	QString _identifier;
+	InternedString _identifier;
 	QPushButton *_descriptionButton;
 	PeakSlider *_volumeSlider;
 	QLabel *_volumeLabel;
 
 	QIcon *icon = nullptr;
-	bool mutedValue;
+	bool mutedValue = false;
+	bool applyingModelValues = false;
+	float displayedPeak = 0.0f;
 
 	IAudioControl &_control;
+	MemoryAccount memory;
 };
 
 class SessionVolumeItem : public VolumeItemBase {
 public:
-	SessionVolumeItem(QWidget *parent, AudioSession &control, const VolumeItemTheme &theme);
+	// ordinal breaks ties between sessions of the same program, it has to be unique in the list
+	SessionVolumeItem(QWidget *parent, AudioSession &control, quint32 ordinal, const VolumeItemTheme &theme);
 
 	const AudioSession &control() const { return _control; }
+	AudioSession &control() { return _control; }
+
+	const QString &executable() const { return _executable; }
+	void setExecutable(QString executable) { _executable = std::move(executable); }
+
+	// Collation key of the identifier followed by pid and ordinal, compare with Collation::Less
+	const QByteArray &sortKey() const { return _sortKey; }
+
+	// While set, volume and mute are written to all group members and the peak is the group peak
+	void setGroup(std::shared_ptr<ExecutableGroup> group) { _group = std::move(group); }
+	const ExecutableGroup *group() const { return _group.get(); }
+
+	// Subscribes to the events of the session for the lifetime of this item
+	void observeSession(std::function<void(float, bool)> volumeChanged, std::function<void(int)> stateChanged);
+
+protected:
+	void volumeChangedEvent(int value) override;
+	void muteChangedEvent(bool mute) override;
+	void identifierChangedEvent() override;
+	float peakValue() const override;
+
 private:
 	AudioSession &_control;
+	QString _executable;
+	QByteArray _sortKey;
+	quint32 ordinal;
+	std::shared_ptr<ExecutableGroup> _group;
+	AudioSession::VolumeObservers::Observer volumeObserver;
+	AudioSession::StateObservers::Observer stateObserver;
 };
 
 class DeviceVolumeItem : public VolumeItemBase {
@@ -128,7 +172,8 @@ public:
 	DeviceVolumeItem(QWidget *parent, DeviceAudioControl &control, const VolumeIcons &icons, const QString &deviceName, const VolumeItemTheme &theme);
 
 	void setVolumeFAndMute(float volume, bool muted);
-	void updateThemeAndIcon(const VolumeItemTheme &theme);
+	void updateThemeAndIcon(const VolumeItemTheme &theme, const VolumeIcons &icons);
+	void setIcons(const VolumeIcons &icons);
 
 protected:
 	void volumeChangedEvent(int value) override;
@@ -137,7 +182,7 @@ private:
 	void updateIcon(int volume);
 
 	DeviceAudioControl &control;
-	const VolumeIcons &icons;
+	const VolumeIcons *icons;
 };
 
 #endif // VOLUMELISTITEM_H
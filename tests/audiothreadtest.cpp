@@ -0,0 +1,182 @@
+#include "audio/audiothread.h"
+#include "audio/backendtrace.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// every backend call takes this long, like a driver stalling
+constexpr std::chrono::milliseconds latency(200);
+// what a caller on the GUI thread may spend on a whole burst of calls
+constexpr qint64 callerBudgetMs = 50;
+
+// Backend with an injected latency, records what reached it and on which thread
+class SlowControlState final : public AudioControlState {
+public:
+	explicit SlowControlState(std::chrono::milliseconds latency, float peakValue = 0.0f) : latency(latency), peakValue(peakValue) {}
+
+	bool readPeak(float &value) override {
+		backendCall();
+		value = peakValue;
+		++peakReads;
+		return true;
+	}
+
+	bool writeVolume(float value) override {
+		backendCall();
+		writtenVolume = value;
+		++volumeWrites;
+		return true;
+	}
+
+	bool writeMuted(bool value) override {
+		backendCall();
+		writtenMuted = value;
+		++muteWrites;
+		return true;
+	}
+
+	std::atomic<int> peakReads{0};
+	std::atomic<int> volumeWrites{0};
+	std::atomic<int> muteWrites{0};
+	std::atomic<float> writtenVolume{-1.0f};
+	std::atomic<bool> writtenMuted{false};
+	std::atomic<bool> calledOnGuiThread{false};
+
+private:
+	void backendCall() {
+		if(QThread::currentThread() == QCoreApplication::instance()->thread())
+			calledOnGuiThread = true;
+		std::this_thread::sleep_for(latency);
+	}
+
+	const std::chrono::milliseconds latency;
+	const float peakValue;
+};
+
+}
+
+class AudioThreadTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void writes();
+	void peaks();
+	void aggregates();
+	void release();
+
+private:
+	// Returns once every command posted before ran
+	static void drain();
+};
+
+void AudioThreadTest::initTestCase() {
+	// the injected latency is expected, not a stall worth a warning
+	BackendTrace::instance().setStallThresholdMs(10000);
+}
+
+void AudioThreadTest::cleanupTestCase() {
+	AudioThread::instance().stop();
+}
+
+void AudioThreadTest::drain() {
+	auto done = std::make_shared<std::atomic<bool>>(false);
+	AudioThread::instance().post([done]() {
+		*done = true;
+	});
+	QTRY_VERIFY_WITH_TIMEOUT(done->load(), 10000);
+}
+
+void AudioThreadTest::writes() {
+	auto &thread = AudioThread::instance();
+	auto state = std::make_shared<SlowControlState>(latency);
+
+	QElapsedTimer timer;
+	timer.start();
+	for(int i = 1; i <= 50; ++i) {
+		thread.setVolume(state, float(i) / 100.0f);
+		thread.setMuted(state, i % 2 == 0);
+		// readers see the new values right away
+		QCOMPARE(state->volume.load(), float(i) / 100.0f);
+		QCOMPARE(state->muted.load(), i % 2 == 0);
+	}
+	QVERIFY2(timer.elapsed() < callerBudgetMs, qPrintable(QString("100 writes blocked the caller for %1 ms").arg(timer.elapsed())));
+
+	drain();
+	QCOMPARE(state->writtenVolume.load(), 0.5f);
+	QCOMPARE(state->writtenMuted.load(), true);
+	// the writes requested while one was queued are folded into it
+	QVERIFY(state->volumeWrites <= 2);
+	QVERIFY(state->muteWrites <= 2);
+	QVERIFY(!state->calledOnGuiThread);
+}
+
+void AudioThreadTest::peaks() {
+	auto &thread = AudioThread::instance();
+	auto state = std::make_shared<SlowControlState>(latency, 0.5f);
+	thread.addMeter(state);
+
+	QElapsedTimer timer;
+	timer.start();
+	for(int i = 0; i < 100; ++i)
+		thread.pollPeaks();
+	QVERIFY2(timer.elapsed() < callerBudgetMs, qPrintable(QString("100 polls blocked the caller for %1 ms").arg(timer.elapsed())));
+
+	drain();
+	QCOMPARE(state->peak.load(), 0.5f);
+	// a poll still queued is not queued again
+	QVERIFY(state->peakReads <= 2);
+	QVERIFY(!state->calledOnGuiThread);
+
+	thread.removeMeter(state.get());
+	const int reads = state->peakReads;
+	thread.pollPeaks();
+	drain();
+	QCOMPARE(state->peakReads.load(), reads);
+}
+
+void AudioThreadTest::aggregates() {
+	auto &thread = AudioThread::instance();
+	auto quiet = std::make_shared<SlowControlState>(std::chrono::milliseconds(0), 0.25f);
+	auto loud = std::make_shared<SlowControlState>(std::chrono::milliseconds(0), 0.75f);
+	auto aggregate = std::make_shared<PeakAggregate>();
+	thread.addMeter(quiet);
+	thread.addMeter(loud);
+	thread.setPeakAggregate(quiet, aggregate);
+	thread.setPeakAggregate(loud, aggregate);
+
+	thread.pollPeaks();
+	drain();
+	QCOMPARE(aggregate->value(), 0.75f);
+
+	thread.removeMeter(quiet.get());
+	thread.removeMeter(loud.get());
+	thread.setPeakAggregate(quiet, nullptr);
+	thread.setPeakAggregate(loud, nullptr);
+	drain();
+}
+
+void AudioThreadTest::release() {
+	// like a session destroyed right after a change, the queued write keeps its backend alive until it ran
+	auto state = std::make_shared<SlowControlState>(latency);
+	const std::weak_ptr<SlowControlState> backend = state;
+	AudioThread::instance().setVolume(state, 0.3f);
+	state.reset();
+	QVERIFY(!backend.expired());
+
+	drain();
+	QVERIFY(backend.expired());
+}
+
+QTEST_GUILESS_MAIN(AudioThreadTest)
+
+#include "audiothreadtest.moc"
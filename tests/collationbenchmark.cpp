@@ -0,0 +1,64 @@
+#include "info/collation.h"
+#include "testing.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <random>
+
+// Sorts 5000 mixed script titles by precomputed collation keys like VolumeControlList, against comparing the
+// strings on every comparison. Sort keys come from LCMapStringEx on Windows only, elsewhere the timings cover
+// the fallback key.
+int main() {
+	const QStringList words{
+		QStringLiteral("Chrome"), QStringLiteral("discord"), QStringLiteral("Zoom"), QStringLiteral("Spotify"),
+		QStringLiteral("Ärzte"), QStringLiteral("élan"), QStringLiteral("Øresund"), QStringLiteral("Яндекс"),
+		QStringLiteral("Телеграм"), QStringLiteral("Ελληνικά"), QStringLiteral("微信"), QStringLiteral("网易云音乐"),
+		QStringLiteral("日本語"), QStringLiteral("한국어"), QStringLiteral("العربية"), QStringLiteral("עברית"),
+		QStringLiteral("हिन्दी"), QStringLiteral("ไทย"), QStringLiteral("VLC"), QStringLiteral("steam")};
+
+	std::mt19937 random(20261019);
+	QStringList titles;
+	constexpr int count = 5000;
+	titles.reserve(count);
+	for(int i = 0; i < count; ++i) {
+		QString title = words[int(random() % unsigned(words.size()))];
+		if(random() % 2)
+			title += QLatin1Char(' ') + words[int(random() % unsigned(words.size()))];
+		// digits sort as numbers in the keys
+		title += QLatin1Char(' ') + QString::number(random() % 200);
+		titles.append(title);
+	}
+
+	std::vector<QByteArray> keys;
+	const double keyTime = Testing::Measure(1, [&] {
+		keys.clear();
+		keys.reserve(count);
+		quint32 ordinal = 0;
+		for(const QString &title : titles) {
+			keys.push_back(Collation::SortKey(title));
+			Collation::AppendTieBreaker(keys.back(), ordinal++);
+		}
+	});
+
+	const double keySortTime = Testing::Measure(1, [&] {
+		auto sorted = keys;
+		std::shuffle(sorted.begin(), sorted.end(), random);
+		std::sort(sorted.begin(), sorted.end(), Collation::Less);
+	});
+
+	const double localeSortTime = Testing::Measure(1, [&] {
+		auto sorted = titles;
+		std::shuffle(sorted.begin(), sorted.end(), random);
+		std::sort(sorted.begin(), sorted.end(), [](const QString &a, const QString &b) {
+			return QString::localeAwareCompare(a, b) < 0;
+		});
+	});
+
+	std::printf("%d titles\n", count);
+	std::printf("%-36s %10.1f us\n", "building keys", keyTime);
+	// both sorts include copying and shuffling the input
+	std::printf("%-36s %10.1f us\n", "sorting keys with Collation::Less", keySortTime);
+	std::printf("%-36s %10.1f us\n", "sorting with localeAwareCompare", localeSortTime);
+	return 0;
+}
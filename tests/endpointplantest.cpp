@@ -0,0 +1,92 @@
+#include "endpointplan.h"
+#include "testing.h"
+
+#include <string>
+
+namespace {
+
+// Stands in for a device section, only its endpoint id matters
+struct FakeSection {
+	std::string id;
+};
+
+using Plan = EndpointPlan<const FakeSection*>;
+
+Plan PlanFor(const std::vector<std::string> &ids, const std::vector<const FakeSection*> &current, const std::vector<std::string> &opened) {
+	return PlanEndpoints(ids, current, [](const FakeSection *section) {
+		return section->id;
+	}, opened, [](const std::string &id) {
+		return id;
+	});
+}
+
+void TestStartup() {
+	const auto plan = PlanFor({"a", "b"}, {}, {"b", "a"});
+	CHECK(plan.sections.size() == 2);
+	CHECK(plan.sections[0].opened == 1);
+	CHECK(plan.sections[1].opened == 0);
+	CHECK(plan.primary().opened == 1);
+	CHECK(plan.removed.empty());
+}
+
+void TestKeptNewAndRemoved() {
+	const FakeSection a{"a"}, b{"b"}, c{"c"};
+	// b was unplugged, d plugged in and c is the new default
+	const auto plan = PlanFor({"c", "d", "a"}, {&a, &b, &c}, {"d"});
+	CHECK(plan.sections.size() == 3);
+	CHECK(plan.sections[0].section == &c);
+	CHECK(plan.sections[0].opened == Plan::npos);
+	CHECK(plan.sections[1].opened == 0);
+	CHECK(plan.sections[2].section == &a);
+	CHECK(plan.sections[2].opened == Plan::npos);
+	CHECK(plan.primary().section == &c);
+	CHECK(plan.removed.size() == 1);
+	CHECK(plan.removed[0] == &b);
+}
+
+void TestReorder() {
+	const FakeSection a{"a"}, b{"b"}, c{"c"};
+	const auto plan = PlanFor({"c", "a", "b"}, {&a, &b, &c}, {});
+	CHECK(plan.sections.size() == 3);
+	CHECK(plan.sections[0].section == &c);
+	CHECK(plan.sections[1].section == &a);
+	CHECK(plan.sections[2].section == &b);
+	CHECK(plan.removed.empty());
+}
+
+void TestUnopenedEndpointsAreSkipped() {
+	const FakeSection b{"b"};
+	// the default a failed to open, the tray follows the next one
+	const auto plan = PlanFor({"a", "b", "c"}, {&b}, {"c"});
+	CHECK(plan.sections.size() == 2);
+	CHECK(plan.primary().section == &b);
+	CHECK(plan.sections[1].opened == 0);
+	CHECK(plan.removed.empty());
+}
+
+void TestNothingOpenedKeepsSections() {
+	const FakeSection a{"a"}, b{"b"};
+	const auto plan = PlanFor({"c"}, {&a, &b}, {});
+	CHECK(plan.empty());
+	CHECK(plan.removed.empty());
+}
+
+void TestOpenedEndpointsOfKeptSectionsAreUnused() {
+	const FakeSection a{"a"};
+	const auto plan = PlanFor({"a"}, {&a}, {"a"});
+	CHECK(plan.sections.size() == 1);
+	CHECK(plan.sections[0].section == &a);
+	CHECK(plan.sections[0].opened == Plan::npos);
+}
+
+}
+
+int main() {
+	TestStartup();
+	TestKeptNewAndRemoved();
+	TestReorder();
+	TestUnopenedEndpointsAreSkipped();
+	TestNothingOpenedKeepsSections();
+	TestOpenedEndpointsOfKeptSectionsAreUnused();
+	return Testing::Result();
+}
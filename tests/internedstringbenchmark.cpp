@@ -0,0 +1,71 @@
+#include "internedstring.h"
+#include "testing.h"
+
+#include <QStringList>
+
+#include <random>
+#include <vector>
+
+// Compares and hashes 5000 titles as interned handles like the session items, against separate QString copies
+// with equal contents that compare and hash their characters.
+int main() {
+	const QStringList words{
+		QStringLiteral("Google Chrome"), QStringLiteral("Discord"), QStringLiteral("Zoom Meetings"), QStringLiteral("Spotify"),
+		QStringLiteral("Microsoft Teams"), QStringLiteral("Mozilla Firefox"), QStringLiteral("VLC media player"), QStringLiteral("Steam"),
+		QStringLiteral("System Sounds"), QStringLiteral("Telegram Desktop"), QStringLiteral("OBS Studio"), QStringLiteral("网易云音乐")};
+
+	std::mt19937 random(20261019);
+	constexpr int count = 5000;
+	// two copies of every title, the second one does not share the data of the first
+	QStringList titles, copies;
+	titles.reserve(count);
+	copies.reserve(count);
+	for(int i = 0; i < count; ++i) {
+		const QString title = words[int(random() % unsigned(words.size()))] + QLatin1Char(' ') + QString::number(random() % 50);
+		titles.append(title);
+		copies.append(QString(title.constData(), title.size()));
+	}
+
+	std::vector<InternedString> interned, internedCopies;
+	const double internTime = Testing::Measure(1, [&] {
+		interned.clear();
+		interned.reserve(count);
+		for(const QString &title : titles)
+			interned.emplace_back(title);
+	});
+	for(const QString &copy : copies)
+		internedCopies.emplace_back(copy);
+
+	// every title against the copy of another one, about every 600th is equal
+	int equal = 0;
+	const double stringCompareTime = Testing::Measure(1, [&] {
+		for(int i = 0; i < count; ++i) {
+			for(int j = 0; j < count; j += 10)
+				equal += titles[i] == copies[j];
+		}
+	});
+	const double internedCompareTime = Testing::Measure(1, [&] {
+		for(int i = 0; i < count; ++i) {
+			for(int j = 0; j < count; j += 10)
+				equal += interned[size_t(i)] == internedCopies[size_t(j)];
+		}
+	});
+
+	uint hash = 0;
+	const double stringHashTime = Testing::Measure(1000, [&] {
+		for(const QString &title : titles)
+			hash ^= qHash(title);
+	});
+	const double internedHashTime = Testing::Measure(1000, [&] {
+		for(const InternedString &title : interned)
+			hash ^= qHash(title);
+	});
+
+	std::printf("%d titles, %d equal pairs, hash %u\n", count, equal, hash);
+	std::printf("%-36s %10.1f us\n", "interning", internTime);
+	std::printf("%-36s %10.1f us\n", "2.5M QString comparisons", stringCompareTime);
+	std::printf("%-36s %10.1f us\n", "2.5M InternedString comparisons", internedCompareTime);
+	std::printf("%-36s %10.1f us\n", "hashing as QString", stringHashTime);
+	std::printf("%-36s %10.1f us\n", "hashing as InternedString", internedHashTime);
+	return 0;
+}
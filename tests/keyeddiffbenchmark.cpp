@@ -0,0 +1,62 @@
+#include "keyeddiff.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+// Diffs rows keyed by pointers like VolumeControlList::reconcileRows does
+int main() {
+	std::mt19937 random(20261019);
+	std::printf("%-24s %8s %12s %10s\n", "scenario", "rows", "us/diff", "operations");
+	for(const size_t rows : {1000, 2000, 5000}) {
+		std::vector<int> items(rows + rows / 10);
+		std::vector<const int*> current(rows);
+		std::iota(current.begin(), current.end(), items.data());
+
+		struct Scenario {
+			const char *name;
+			std::vector<const int*> target;
+		};
+		std::vector<Scenario> scenarios;
+		scenarios.push_back({"unchanged", current});
+
+		auto inserted = current;
+		inserted.insert(inserted.begin() + long(rows / 2), items.data() + rows);
+		scenarios.push_back({"one inserted", inserted});
+
+		auto removed = current;
+		removed.erase(removed.begin() + long(rows / 3));
+		scenarios.push_back({"one removed", removed});
+
+		auto resorted = current;
+		std::rotate(resorted.begin() + long(rows / 4), resorted.begin() + long(rows / 4) + 1, resorted.end());
+		scenarios.push_back({"one moved", resorted});
+
+		// a tenth of the sessions expire and as many new ones appear
+		auto churn = current;
+		std::shuffle(churn.begin(), churn.end(), random);
+		churn.resize(rows - rows / 10);
+		for(size_t i = 0; i < rows / 10; ++i)
+			churn.push_back(items.data() + rows + i);
+		std::sort(churn.begin(), churn.end());
+		scenarios.push_back({"10% churn", churn});
+
+		auto reversed = current;
+		std::reverse(reversed.begin(), reversed.end());
+		scenarios.push_back({"reversed", reversed});
+
+		auto shuffled = current;
+		std::shuffle(shuffled.begin(), shuffled.end(), random);
+		scenarios.push_back({"shuffled", shuffled});
+
+		for(const auto &scenario : scenarios) {
+			size_t operations = 0;
+			const double time = Testing::Measure(20, [&] {
+				operations = ComputeKeyedDiff(current, scenario.target).operationCount();
+			});
+			std::printf("%-24s %8zu %12.1f %10zu\n", scenario.name, rows, time, operations);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include "keyeddiff.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+
+namespace {
+
+// Length of a longest strictly increasing subsequence, quadratic reference
+size_t ReferenceLisLength(const std::vector<size_t> &values) {
+	std::vector<size_t> lengths(values.size(), 1);
+	size_t longest = 0;
+	for(size_t i = 0; i < values.size(); ++i) {
+		for(size_t j = 0; j < i; ++j) {
+			if(values[j] < values[i])
+				lengths[i] = std::max(lengths[i], lengths[j] + 1);
+		}
+		longest = std::max(longest, lengths[i]);
+	}
+	return longest;
+}
+
+// Checks that diff is a valid edit script from current to target with the minimal number of moves
+void CheckDiff(const std::vector<int> &current, const std::vector<int> &target, const KeyedDiff &diff) {
+	CHECK(diff.sources.size() == target.size());
+	const std::unordered_set<int> targetKeys(target.begin(), target.end());
+
+	std::vector<size_t> removed;
+	for(size_t i = 0; i < current.size(); ++i) {
+		if(!targetKeys.count(current[i]))
+			removed.push_back(i);
+	}
+	CHECK(diff.removed == removed);
+
+	std::vector<size_t> inserted;
+	std::vector<size_t> keptSources;
+	for(size_t i = 0; i < target.size(); ++i) {
+		const size_t source = diff.sources[i];
+		if(source == KeyedDiff::npos) {
+			CHECK(std::find(current.begin(), current.end(), target[i]) == current.end());
+			inserted.push_back(i);
+			continue;
+		}
+		CHECK(source < current.size() && current[source] == target[i]);
+		keptSources.push_back(source);
+	}
+	CHECK(diff.inserted == inserted);
+
+	// rows that are not moved keep their relative order
+	CHECK(std::is_sorted(diff.moved.begin(), diff.moved.end()));
+	size_t previous = KeyedDiff::npos;
+	for(size_t i = 0; i < target.size(); ++i) {
+		const size_t source = diff.sources[i];
+		if(source == KeyedDiff::npos || std::binary_search(diff.moved.begin(), diff.moved.end(), i))
+			continue;
+		CHECK(previous == KeyedDiff::npos || previous < source);
+		previous = source;
+	}
+	CHECK(diff.moved.size() == keptSources.size() - ReferenceLisLength(keptSources));
+	CHECK(diff.operationCount() == diff.removed.size() + diff.moved.size() + diff.inserted.size());
+}
+
+void CheckDiff(const std::vector<int> &current, const std::vector<int> &target) {
+	CheckDiff(current, target, ComputeKeyedDiff(current, target));
+}
+
+void TestUnchanged() {
+	const std::vector<int> rows{1, 2, 3, 4};
+	const auto diff = ComputeKeyedDiff(rows, rows);
+	CHECK(diff.empty());
+	CHECK((diff.sources == std::vector<size_t>{0, 1, 2, 3}));
+	CheckDiff(rows, rows, diff);
+}
+
+void TestInsert() {
+	const auto diff = ComputeKeyedDiff<int>({1, 2, 3}, {1, 5, 2, 3, 6});
+	CHECK((diff.inserted == std::vector<size_t>{1, 4}));
+	CHECK(diff.removed.empty());
+	CHECK(diff.moved.empty());
+	CHECK((diff.sources == std::vector<size_t>{0, KeyedDiff::npos, 1, 2, KeyedDiff::npos}));
+	CheckDiff({1, 2, 3}, {1, 5, 2, 3, 6}, diff);
+}
+
+void TestRemove() {
+	const auto diff = ComputeKeyedDiff<int>({1, 2, 3, 4}, {2, 4});
+	CHECK((diff.removed == std::vector<size_t>{0, 2}));
+	CHECK(diff.inserted.empty());
+	CHECK(diff.moved.empty());
+	CHECK((diff.sources == std::vector<size_t>{1, 3}));
+	CheckDiff({1, 2, 3, 4}, {2, 4}, diff);
+}
+
+void TestMove() {
+	// moving the last row to the front moves exactly that row
+	const auto toFront = ComputeKeyedDiff<int>({1, 2, 3, 4}, {4, 1, 2, 3});
+	CHECK((toFront.moved == std::vector<size_t>{0}));
+	CheckDiff({1, 2, 3, 4}, {4, 1, 2, 3}, toFront);
+
+	// swapping two neighbours moves one of them
+	const auto swap = ComputeKeyedDiff<int>({1, 2, 3, 4}, {1, 3, 2, 4});
+	CHECK(swap.moved.size() == 1);
+	CheckDiff({1, 2, 3, 4}, {1, 3, 2, 4}, swap);
+
+	// a reversal keeps one row
+	const auto reversed = ComputeKeyedDiff<int>({1, 2, 3, 4, 5}, {5, 4, 3, 2, 1});
+	CHECK(reversed.moved.size() == 4);
+	CheckDiff({1, 2, 3, 4, 5}, {5, 4, 3, 2, 1}, reversed);
+}
+
+void TestMixed() {
+	const std::vector<int> current{1, 2, 3, 4, 5, 6};
+	const std::vector<int> target{7, 6, 2, 3, 8, 5};
+	const auto diff = ComputeKeyedDiff(current, target);
+	CHECK((diff.removed == std::vector<size_t>{0, 3}));
+	CHECK((diff.inserted == std::vector<size_t>{0, 4}));
+	CHECK((diff.moved == std::vector<size_t>{1}));
+	CheckDiff(current, target, diff);
+}
+
+void TestEmpty() {
+	const std::vector<int> empty;
+	const std::vector<int> full{3, 1, 2};
+
+	const auto nothing = ComputeKeyedDiff(empty, empty);
+	CHECK(nothing.empty());
+	CHECK(nothing.sources.empty());
+
+	const auto fill = ComputeKeyedDiff(empty, full);
+	CHECK((fill.inserted == std::vector<size_t>{0, 1, 2}));
+	CHECK(fill.removed.empty() && fill.moved.empty());
+	CheckDiff(empty, full, fill);
+
+	const auto clear = ComputeKeyedDiff(full, empty);
+	CHECK((clear.removed == std::vector<size_t>{0, 1, 2}));
+	CHECK(clear.inserted.empty() && clear.moved.empty() && clear.sources.empty());
+	CheckDiff(full, empty, clear);
+}
+
+void TestLongestIncreasingSubsequence() {
+	CHECK(LongestIncreasingSubsequence(std::vector<size_t>{}).empty());
+
+	const std::vector<size_t> values{5, 1, 4, 2, 3, 9, 0};
+	const auto positions = LongestIncreasingSubsequence(values);
+	CHECK(positions.size() == 4);
+	for(size_t i = 1; i < positions.size(); ++i)
+		CHECK(positions[i - 1] < positions[i] && values[positions[i - 1]] < values[positions[i]]);
+}
+
+// Random churn against the reference, covers the minimality of the moves
+void TestRandom() {
+	std::mt19937 random(20261019);
+	for(int round = 0; round < 500; ++round) {
+		const int keys = int(random() % 40);
+		std::vector<int> current;
+		std::vector<int> target;
+		for(int key = 0; key < keys; ++key) {
+			const unsigned roll = random() % 8;
+			if(roll != 0)
+				current.push_back(key);
+			if(roll != 1)
+				target.push_back(key);
+		}
+		// new keys only in the target
+		for(int key = keys; key < keys + int(random() % 5); ++key)
+			target.push_back(key);
+		std::shuffle(current.begin(), current.end(), random);
+		if(round % 2 == 0) {
+			// mostly sorted like after a single session changed its title
+			std::sort(target.begin(), target.end());
+			if(target.size() > 1)
+				std::swap(target[random() % target.size()], target[random() % target.size()]);
+		} else {
+			std::shuffle(target.begin(), target.end(), random);
+		}
+		CheckDiff(current, target);
+	}
+}
+
+}
+
+int main() {
+	TestUnchanged();
+	TestInsert();
+	TestRemove();
+	TestMove();
+	TestMixed();
+	TestEmpty();
+	TestLongestIncreasingSubsequence();
+	TestRandom();
+	return Testing::Result();
+}
@@ -0,0 +1,150 @@
+#include "metrics.h"
+
+#include <QLocalSocket>
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <memory>
+
+class MetricsTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void counters();
+	void histograms();
+	void gauges();
+	void scrape();
+
+private:
+	// Lines of one family from its HELP line up to the next family
+	static QByteArray family(const QByteArray &exposition, const QByteArray &name);
+};
+
+void MetricsTest::initTestCase() {
+	// keeps the scrape test off the socket of a running instance
+	qputenv("USERNAME", "metricstest");
+}
+
+QByteArray MetricsTest::family(const QByteArray &exposition, const QByteArray &name) {
+	const int start = exposition.indexOf("# HELP " + name + ' ');
+	if(start < 0)
+		return {};
+	const int end = exposition.indexOf("# HELP ", start + 1);
+	return exposition.mid(start, end < 0 ? -1 : end - start);
+}
+
+void MetricsTest::counters() {
+	auto &metrics = Metrics::instance();
+	const QByteArray path = Metrics::label("path", "C:\\Program Files\\\"quoted\"\nnext");
+	QCOMPARE(path, QByteArray("path=\"C:\\\\Program Files\\\\\\\"quoted\\\"\\nnext\""));
+
+	Counter &escaped = metrics.counter("test_requests_total", "Requests by path\\with a\nline feed", path.constData());
+	Counter &plain = metrics.counter("test_requests_total", "", "path=\"plain\"");
+	escaped.add(3);
+	plain.add();
+	// the same name and labels return the same counter
+	QCOMPARE(&metrics.counter("test_requests_total", "", path.constData()), &escaped);
+	QCOMPARE(&metrics.counter("test_requests_total", "", "path=\"plain\""), &plain);
+
+	QCOMPARE(family(metrics.exposition(), "test_requests_total"),
+				QByteArray("# HELP test_requests_total Requests by path\\\\with a\\nline feed\n"
+							  "# TYPE test_requests_total counter\n"
+							  "test_requests_total{path=\"C:\\\\Program Files\\\\\\\"quoted\\\"\\nnext\"} 3\n"
+							  "test_requests_total{path=\"plain\"} 1\n"));
+}
+
+void MetricsTest::histograms() {
+	auto &metrics = Metrics::instance();
+	LatencyHistogram &histogram = metrics.histogram("test_latency_seconds", "Latency of tests", "kind=\"unit\"");
+	QCOMPARE(&metrics.histogram("test_latency_seconds", "", "kind=\"unit\""), &histogram);
+	histogram.record(1);
+	histogram.record(3);
+	histogram.record(100);
+	histogram.record(5000000);
+
+	const QByteArray expected =
+			"# HELP test_latency_seconds Latency of tests\n"
+			"# TYPE test_latency_seconds histogram\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"2e-06\"} 1\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"4e-06\"} 2\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"8e-06\"} 2\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"1.6e-05\"} 2\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"3.2e-05\"} 2\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"6.4e-05\"} 2\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.000128\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.000256\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.000512\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.001024\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.002048\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.004096\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.008192\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.016384\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.032768\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.065536\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.131072\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.262144\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"0.524288\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"1.04858\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"2.09715\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"4.1943\"} 3\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"8.38861\"} 4\n"
+			"test_latency_seconds_bucket{kind=\"unit\",le=\"+Inf\"} 4\n"
+			"test_latency_seconds_sum{kind=\"unit\"} 5.000104\n"
+			"test_latency_seconds_count{kind=\"unit\"} 4\n";
+	QCOMPARE(family(metrics.exposition(), "test_latency_seconds"), expected);
+}
+
+void MetricsTest::gauges() {
+	auto &metrics = Metrics::instance();
+	auto context = std::make_unique<QObject>();
+	qreal rows = 12;
+	metrics.addGauge("test_rows", "Rows of a test", "list=\"a\"", context.get(), [&rows]() {
+		return rows;
+	});
+	metrics.addGauge("test_rows", "", "list=\"b\"", nullptr, []() {
+		return 0.5;
+	});
+	QCOMPARE(family(metrics.exposition(), "test_rows"),
+				QByteArray("# HELP test_rows Rows of a test\n"
+							  "# TYPE test_rows gauge\n"
+							  "test_rows{list=\"a\"} 12\n"
+							  "test_rows{list=\"b\"} 0.5\n"));
+
+	// skipped once its context is gone
+	context.reset();
+	QCOMPARE(family(metrics.exposition(), "test_rows"),
+				QByteArray("# HELP test_rows Rows of a test\n"
+							  "# TYPE test_rows gauge\n"
+							  "test_rows{list=\"b\"} 0.5\n"));
+}
+
+void MetricsTest::scrape() {
+	Metrics::instance().counter("test_scrapes_total", "Scrapes of the test").add(7);
+
+	MetricsServer server;
+	QVERIFY(server.listen());
+
+	QLocalSocket socket;
+	QByteArray received;
+	connect(&socket, &QLocalSocket::readyRead, this, [&]() {
+		received += socket.readAll();
+	});
+	QSignalSpy disconnected(&socket, &QLocalSocket::disconnected);
+	socket.connectToServer(MetricsServer::serverName());
+	QVERIFY(socket.waitForConnected(5000));
+	// the server closes the connection once the whole exposition is written
+	QTRY_COMPARE(disconnected.count(), 1);
+	received += socket.readAll();
+
+	QVERIFY(received.startsWith("# HELP "));
+	QVERIFY(received.endsWith('\n'));
+	QCOMPARE(family(received, "test_scrapes_total"),
+				QByteArray("# HELP test_scrapes_total Scrapes of the test\n"
+							  "# TYPE test_scrapes_total counter\n"
+							  "test_scrapes_total 7\n"));
+}
+
+QTEST_GUILESS_MAIN(MetricsTest)
+
+#include "metricstest.moc"
@@ -0,0 +1,233 @@
+#include "observerlist.h"
+#include "testing.h"
+#include "audio/audioevents.h"
+
+#include <QCoreApplication>
+#include <QObject>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Per session memory and notification cost of the observer lists of AudioSession, against the signals it had before.
+// Backend callbacks come from other threads, so the queued delivery to the GUI thread is measured as well.
+
+namespace {
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> allocatedBytes{0};
+}
+
+void *operator new(size_t size) {
+	++allocations;
+	allocatedBytes += size;
+	if(void *memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+	std::free(memory);
+}
+
+namespace {
+
+class SignalSession : public QObject {
+	Q_OBJECT
+signals:
+	void volumeChanged(float newVolume, bool newMute);
+	void stateChanged(int newState);
+	void groupingParamChanged(const void *newGroupingParam);
+};
+
+struct ObserverSession {
+	ObserverList<float, bool> volumeObservers;
+	ObserverList<int> stateObservers;
+	ObserverList<const void *> groupingParamObservers;
+};
+
+// What a row subscribes to, volume and state
+class SignalRow : public QObject {
+	Q_OBJECT
+public:
+	explicit SignalRow(SignalSession &session) {
+		connect(&session, &SignalSession::volumeChanged, this, [this](float volume, bool) { this->volume = volume; });
+		connect(&session, &SignalSession::stateChanged, this, [this](int state) { this->state = state; });
+	}
+
+	float volume = 0;
+	int state = 0;
+};
+
+struct ObserverRow {
+	explicit ObserverRow(ObserverSession &session)
+		: volumeObserver([this](float volume, bool) { this->volume = volume; })
+		, stateObserver([this](int state) { this->state = state; }) {
+		volumeObserver.subscribe(session.volumeObservers);
+		stateObserver.subscribe(session.stateObservers);
+	}
+
+	ObserverList<float, bool>::Observer volumeObserver;
+	ObserverList<int>::Observer stateObserver;
+	float volume = 0;
+	int state = 0;
+};
+
+// What the session signals were connected with, the callbacks run on other threads
+class QueuedSignalRow : public QObject {
+	Q_OBJECT
+public:
+	explicit QueuedSignalRow(SignalSession &session, int &received) : received(received) {
+		connect(&session, &SignalSession::stateChanged, this, [this](int state) {
+			this->state = state;
+			++this->received;
+		}, Qt::QueuedConnection);
+	}
+
+	int state = 0;
+	int &received;
+};
+
+// Session as it is now, events of callbacks go through the AudioEventQueue to its observer lists
+class QueuedSession final : public AudioEventSource {
+public:
+	ObserverList<float, bool> volumeObservers;
+	ObserverList<int> stateObservers;
+
+protected:
+	void deliver(const AudioEvent &event) override {
+		if(event.type == AudioEvent::Type::Volume)
+			volumeObservers.notify(event.volume, event.muted);
+		else if(event.type == AudioEvent::Type::State)
+			stateObservers.notify(event.state);
+	}
+};
+
+struct QueuedObserverRow {
+	QueuedObserverRow(QueuedSession &session, int &received)
+		: stateObserver([this, &received](int state) {
+			this->state = state;
+			++received;
+		}) {
+		stateObserver.subscribe(session.stateObservers);
+	}
+
+	ObserverList<int>::Observer stateObserver;
+	int state = 0;
+};
+
+struct Cost {
+	size_t allocations;
+	size_t bytes;
+};
+
+struct Delivery {
+	// time a callback spends handing over an event, on the posting thread
+	double postNs;
+	// from the first post until the last event reached its row, per event
+	double deliveredNs;
+	size_t allocations;
+};
+
+// State events posted from a worker thread round robin to sessionCount sessions, until all reached their rows on this thread.
+// State events are not coalesced, so both ways deliver every event.
+template<typename Session, typename Row, typename Post>
+Delivery MeasureQueued(Post post) {
+	constexpr int sessionCount = 100;
+	constexpr int events = 100000;
+	constexpr int runs = 5;
+	std::vector<std::unique_ptr<Session>> sessions;
+	std::vector<std::unique_ptr<Row>> rows;
+	int received = 0;
+	for(int i = 0; i < sessionCount; ++i) {
+		sessions.push_back(std::make_unique<Session>());
+		rows.push_back(std::make_unique<Row>(*sessions.back(), received));
+	}
+
+	Delivery best{0, 0, 0};
+	for(int run = 0; run < runs; ++run) {
+		received = 0;
+		const size_t startAllocations = allocations;
+		const auto start = std::chrono::steady_clock::now();
+		std::chrono::duration<double, std::nano> posting{};
+		std::thread worker([&] {
+			const auto postStart = std::chrono::steady_clock::now();
+			for(int i = 0; i < events; ++i)
+				post(*sessions[size_t(i % sessionCount)], i);
+			posting = std::chrono::steady_clock::now() - postStart;
+		});
+		while(received < events)
+			QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		worker.join();
+
+		const Delivery delivery{posting.count() / events, elapsed.count() / events, (allocations - startAllocations) / events};
+		if(run == 0 || delivery.deliveredNs < best.deliveredNs)
+			best = delivery;
+	}
+	return best;
+}
+
+// Heap allocations of creating sessions with one subscribed row each, per session
+template<typename Session, typename Row>
+Cost MeasureMemory() {
+	constexpr size_t count = 1000;
+	std::vector<std::unique_ptr<Session>> sessions;
+	std::vector<std::unique_ptr<Row>> rows;
+	sessions.reserve(count);
+	rows.reserve(count);
+	const size_t startAllocations = allocations;
+	const size_t startBytes = allocatedBytes;
+	for(size_t i = 0; i < count; ++i) {
+		sessions.push_back(std::make_unique<Session>());
+		rows.push_back(std::make_unique<Row>(*sessions.back()));
+	}
+	return {(allocations - startAllocations) / count, (allocatedBytes - startBytes) / count};
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	const auto signalMemory = MeasureMemory<SignalSession, SignalRow>();
+	const auto observerMemory = MeasureMemory<ObserverSession, ObserverRow>();
+	std::printf("%-16s %14s %14s %18s\n", "", "allocations", "heap bytes", "notify ns");
+
+	constexpr int calls = 1000000;
+	float volume = 0;
+	SignalSession signalSession;
+	SignalRow signalRow(signalSession);
+	const double signalTime = Testing::Measure(calls, [&] {
+		emit signalSession.volumeChanged(volume += 0.001f, false);
+	});
+
+	ObserverSession observerSession;
+	ObserverRow observerRow(observerSession);
+	const double observerTime = Testing::Measure(calls, [&] {
+		observerSession.volumeObservers.notify(volume += 0.001f, false);
+	});
+
+	// allocations and bytes are per session and its row, the object sizes themselves included
+	std::printf("%-16s %14zu %14zu %18.1f\n", "signals", signalMemory.allocations, signalMemory.bytes, signalTime * 1000);
+	std::printf("%-16s %14zu %14zu %18.1f\n", "observer lists", observerMemory.allocations, observerMemory.bytes, observerTime * 1000);
+
+	const auto queuedSignals = MeasureQueued<SignalSession, QueuedSignalRow>([](SignalSession &session, int state) {
+		emit session.stateChanged(state);
+	});
+	const auto queuedEvents = MeasureQueued<QueuedSession, QueuedObserverRow>([](QueuedSession &session, int state) {
+		AudioEventQueue::instance().post(AudioEvent::stateChanged(session, state));
+	});
+	// allocations are per event, on both threads
+	std::printf("\n%-16s %14s %14s %18s\n", "cross thread", "allocations", "post ns", "delivered ns");
+	std::printf("%-16s %14zu %14.1f %18.1f\n", "queued signals", queuedSignals.allocations, queuedSignals.postNs, queuedSignals.deliveredNs);
+	std::printf("%-16s %14zu %14.1f %18.1f\n", "event queue", queuedEvents.allocations, queuedEvents.postNs, queuedEvents.deliveredNs);
+	return 0;
+}
+
+#include "observerlistbenchmark.moc"
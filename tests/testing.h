@@ -0,0 +1,48 @@
+#ifndef TESTING_H
+#define TESTING_H
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+// Minimal checks for the parts without Qt dependencies, a test executable returns Testing::Result()
+namespace Testing {
+	inline int &Failures() {
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Check(bool passed, const char *expression, const char *file, int line) {
+		if(passed)
+			return;
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+		++Failures();
+	}
+
+	inline int Result() {
+		if(Failures() == 0)
+			std::printf("All checks passed\n");
+		else
+			std::fprintf(stderr, "%d checks failed\n", Failures());
+		return Failures() == 0 ? 0 : 1;
+	}
+
+	// Fastest of several runs of function in microseconds, per call
+	inline double Measure(int calls, const std::function<void()> &function, int runs = 5) {
+		double best = 0;
+		for(int run = 0; run < runs; ++run) {
+			const auto start = std::chrono::steady_clock::now();
+			for(int i = 0; i < calls; ++i)
+				function();
+			const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+			const double perCall = elapsed.count() / calls;
+			if(run == 0 || perCall < best)
+				best = perCall;
+		}
+		return best;
+	}
+}
+
+#define CHECK(condition) Testing::Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#endif // TESTING_H
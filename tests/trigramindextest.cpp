@@ -0,0 +1,107 @@
+#include "trigramindex.h"
+
+#include <QtTest>
+
+using Index = TrigramIndex<int>;
+
+class TrigramIndexTest : public QObject {
+	Q_OBJECT
+
+private slots:
+	void insert();
+	void remove();
+	void replace();
+	void shortQueries();
+	void longQueries();
+
+private:
+	// Sample of session titles, ids 1 to 4
+	static Index programs();
+};
+
+Index TrigramIndexTest::programs() {
+	Index index;
+	index.insert(1, "Google Chrome\nchrome.exe");
+	index.insert(2, "Discord\nDiscord.exe");
+	index.insert(3, "Microsoft Teams\nms-teams.exe");
+	index.insert(4, "Спотифай\nSpotify.exe");
+	return index;
+}
+
+void TrigramIndexTest::insert() {
+	const Index index = programs();
+	QCOMPARE(index.size(), size_t(4));
+	QCOMPARE(index.find("chrome"), Index::Result({1}));
+	// case folded, also outside of latin
+	QCOMPARE(index.find("DISCORD"), Index::Result({2}));
+	QCOMPARE(index.find("СПОТ"), Index::Result({4}));
+	QCOMPARE(index.find(".exe"), Index::Result({1, 2, 3, 4}));
+	QCOMPARE(index.find("firefox"), Index::Result());
+}
+
+void TrigramIndexTest::remove() {
+	Index index = programs();
+	index.remove(2);
+	QCOMPARE(index.size(), size_t(3));
+	QCOMPARE(index.find("discord"), Index::Result());
+	QCOMPARE(index.find(".exe"), Index::Result({1, 3, 4}));
+	QCOMPARE(index.find("d"), Index::Result());
+
+	// unknown ids are ignored
+	index.remove(2);
+	index.remove(42);
+	QCOMPARE(index.size(), size_t(3));
+
+	index.remove(1);
+	index.remove(3);
+	index.remove(4);
+	QCOMPARE(index.size(), size_t(0));
+	QCOMPARE(index.find(".exe"), Index::Result());
+	QCOMPARE(index.find(""), Index::Result());
+}
+
+void TrigramIndexTest::replace() {
+	Index index = programs();
+	// like a title updated by the reconcile of the snapshot
+	index.insert(1, "Chromium\nchromium.exe");
+	QCOMPARE(index.size(), size_t(4));
+	QCOMPARE(index.find("google"), Index::Result());
+	QCOMPARE(index.find("chromium"), Index::Result({1}));
+	QCOMPARE(index.find("chrom"), Index::Result({1}));
+	QCOMPARE(index.find("go"), Index::Result());
+
+	// no posting of an old text is left, it would look up the removed id
+	index.insert(1, "Zoom");
+	index.remove(1);
+	QCOMPARE(index.find("chromium"), Index::Result());
+	QCOMPARE(index.find("zoo"), Index::Result());
+}
+
+void TrigramIndexTest::shortQueries() {
+	const Index index = programs();
+	// every text contains the empty query
+	QCOMPARE(index.find(""), Index::Result({1, 2, 3, 4}));
+	QCOMPARE(index.find("m"), Index::Result({1, 3}));
+	QCOMPARE(index.find("Ms"), Index::Result({3}));
+	QCOMPARE(index.find("ф"), Index::Result({4}));
+	// across the line feed between title and file name
+	QCOMPARE(index.find("d\n"), Index::Result({2}));
+	QCOMPARE(index.find("qq"), Index::Result());
+}
+
+void TrigramIndexTest::longQueries() {
+	Index index = programs();
+	QCOMPARE(index.find("tea"), Index::Result({3}));
+	QCOMPARE(index.find("Microsoft Teams"), Index::Result({3}));
+	QCOMPARE(index.find("teams\nms-teams.exe"), Index::Result({3}));
+	// all trigrams occur in the text, the substring does not
+	index.insert(5, "abcd bcde");
+	QCOMPARE(index.find("abcde"), Index::Result());
+	QCOMPARE(index.find("bcd"), Index::Result({5}));
+	// longer than every text
+	QCOMPARE(index.find("Google Chrome\nchrome.exe and more"), Index::Result());
+}
+
+QTEST_GUILESS_MAIN(TrigramIndexTest)
+
+#include "trigramindextest.moc"
@@ -0,0 +1,101 @@
+#include "info/windowmap.h"
+#include "testing.h"
+
+namespace {
+
+struct FakeClock {
+	using duration = std::chrono::milliseconds;
+	using time_point = std::chrono::time_point<FakeClock, duration>;
+
+	static time_point now() { return time; }
+
+	static time_point time;
+};
+
+FakeClock::time_point FakeClock::time;
+
+using TestWindowMap = WindowMap<int, FakeClock>;
+
+// Synthetic top level windows in z-order, counts the enumerations
+struct FakeDesktop {
+	std::vector<TestWindowMap::WindowInfo> windows;
+	int enumerations = 0;
+
+	TestWindowMap::Enumerator enumerator() {
+		return [this] {
+			++enumerations;
+			return windows;
+		};
+	}
+};
+
+const std::chrono::milliseconds timeToLive(2000);
+
+void TestFirstQualifyingWindowWins() {
+	FakeDesktop desktop;
+	desktop.windows = {
+		{10, 100, false, true},
+		{10, 101, false, true},
+		{20, 200, true, true},
+		{20, 201, false, false},
+		{20, 202, false, true},
+		{30, 300, true, false},
+	};
+	TestWindowMap windows(desktop.enumerator(), timeToLive);
+	CHECK(windows.find(10) == 100);
+	// owned and invisible windows are skipped
+	CHECK(windows.find(20) == 202);
+	CHECK(!windows.find(30));
+	CHECK(!windows.find(40));
+	CHECK(desktop.enumerations == 1);
+}
+
+void TestTimeToLive() {
+	FakeDesktop desktop;
+	desktop.windows = {{10, 100, false, true}};
+	TestWindowMap windows(desktop.enumerator(), timeToLive);
+
+	bool rebuilt = false;
+	CHECK(windows.find(10, &rebuilt) == 100);
+	CHECK(rebuilt);
+	CHECK(desktop.enumerations == 1);
+
+	// lookups inside the time to live are served from the map, even when the windows changed meanwhile
+	desktop.windows = {{10, 110, false, true}, {20, 200, false, true}};
+	FakeClock::time += timeToLive - std::chrono::milliseconds(1);
+	CHECK(windows.find(10, &rebuilt) == 100);
+	CHECK(!rebuilt);
+	CHECK(!windows.find(20, &rebuilt));
+	CHECK(!rebuilt);
+	CHECK(desktop.enumerations == 1);
+
+	// the first lookup after it rebuilds exactly once
+	FakeClock::time += std::chrono::milliseconds(1);
+	CHECK(windows.find(20, &rebuilt) == 200);
+	CHECK(rebuilt);
+	CHECK(windows.find(10, &rebuilt) == 110);
+	CHECK(!rebuilt);
+	CHECK(desktop.enumerations == 2);
+	CHECK(windows.rebuilds() == 2);
+}
+
+void TestInvalidate() {
+	FakeDesktop desktop;
+	desktop.windows = {{10, 100, false, true}};
+	TestWindowMap windows(desktop.enumerator(), timeToLive);
+	CHECK(windows.find(10) == 100);
+	desktop.windows = {{10, 101, false, true}};
+	windows.invalidate();
+	CHECK(windows.find(10) == 101);
+	CHECK(windows.find(10) == 101);
+	CHECK(desktop.enumerations == 2);
+}
+
+}
+
+int main() {
+	TestFirstQualifyingWindowWins();
+	TestTimeToLive();
+	TestInvalidate();
+	return Testing::Result();
+}